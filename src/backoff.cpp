@@ -0,0 +1,133 @@
+// backoff.cpp
+#include "backoff.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+struct BackoffPolicy {
+    int base_ms;
+    int cap_ms;
+    int park_after;  // failures in a row before the circuit opens
+};
+
+// Indexed by FailureKind
+static const BackoffPolicy kPolicies[] = {
+    {30000, 600000, 3},   // auth
+    {5000, 120000, 10},   // dns
+    {2000, 60000, 20},    // refused
+    {500, 30000, 30},     // network
+    {1000, 30000, 8},     // decoder
+    {250, 10000, 30},     // eos
+};
+static_assert(G_N_ELEMENTS(kPolicies) == kFailureKinds, "one policy per FailureKind");
+
+static const int kParkMs = 5 * 60 * 1000;
+static const int kParkMaxMs = 30 * 60 * 1000;
+
+static GstPadProbeReturn on_frame(GstPad* /*pad*/, GstPadProbeInfo* /*info*/, gpointer user_data) {
+    std::atomic<bool>* streamed = static_cast<std::atomic<bool>*>(user_data);
+    if (!streamed->load(std::memory_order_relaxed)) streamed->store(true, std::memory_order_relaxed);
+    return GST_PAD_PROBE_OK;
+}
+
+void backoff_init(ReconnectBackoff* b, const std::string& name) {
+    b->name = name;
+    b->delay_ms = 0;
+    std::fill(std::begin(b->failures), std::end(b->failures), 0);
+    b->parks = 0;
+    b->parked = false;
+    b->streamed = false;
+}
+
+void backoff_watch(ReconnectBackoff* b, GstElement* element) {
+    GstPad* pad = element ? gst_element_get_static_pad(element, "sink") : nullptr;
+    if (!pad) return;
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, on_frame, &b->streamed, nullptr);
+    gst_object_unref(pad);
+}
+
+void backoff_success(ReconnectBackoff* b) {
+    b->streamed = true;
+}
+
+// Case-insensitive substring search in message and debug text.
+static bool mentions(const gchar* text, const char* what) {
+    if (!text) return false;
+    gchar* lower = g_ascii_strdown(text, -1);
+    bool found = std::strstr(lower, what) != nullptr;
+    g_free(lower);
+    return found;
+}
+
+FailureKind backoff_classify(GstMessage* msg, bool from_decoder) {
+    if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS) return FailureKind::Eos;
+    if (from_decoder) return FailureKind::Decoder;
+    if (GST_MESSAGE_TYPE(msg) != GST_MESSAGE_ERROR) return FailureKind::Network;
+
+    GError* err = nullptr; gchar* dbg = nullptr;
+    gst_message_parse_error(msg, &err, &dbg);
+    FailureKind kind = FailureKind::Network;
+    const gchar* text = err ? err->message : nullptr;
+    if (err && err->domain == GST_RESOURCE_ERROR && err->code == GST_RESOURCE_ERROR_NOT_AUTHORIZED) {
+        kind = FailureKind::Auth;
+    } else if (mentions(text, "unauthorized") || mentions(dbg, "unauthorized") || mentions(dbg, "forbidden")) {
+        kind = FailureKind::Auth;
+    } else if (mentions(text, "resolv") || mentions(dbg, "resolv") || mentions(dbg, "name or service not known") ||
+               mentions(dbg, "no address associated")) {
+        kind = FailureKind::Dns;
+    } else if (mentions(text, "refused") || mentions(dbg, "refused")) {
+        kind = FailureKind::Refused;
+    }
+    if (err) g_error_free(err); if (dbg) g_free(dbg);
+    return kind;
+}
+
+const char* failure_kind_name(FailureKind kind) {
+    switch (kind) {
+    case FailureKind::Auth: return "auth";
+    case FailureKind::Dns: return "dns";
+    case FailureKind::Refused: return "refused";
+    case FailureKind::Network: return "network";
+    case FailureKind::Decoder: return "decoder";
+    case FailureKind::Eos: return "eos";
+    }
+    return "network";
+}
+
+int backoff_next(ReconnectBackoff* b, FailureKind kind) {
+    if (b->streamed.exchange(false)) {
+        b->delay_ms = 0;
+        std::fill(std::begin(b->failures), std::end(b->failures), 0);
+        b->parks = 0;
+        b->parked = false;
+    }
+    const bool probe_failed = b->parked;  // the single attempt after a park
+    const BackoffPolicy& p = kPolicies[(int)kind];
+    b->last = kind;
+    const int failures = ++b->failures[(int)kind];
+
+    if (probe_failed || failures >= p.park_after) {
+        b->delay_ms = std::min(kParkMs << std::min(b->parks, 3), kParkMaxMs);
+        ++b->parks;
+        b->parked = true;
+        return b->delay_ms;
+    }
+    b->parked = false;
+
+    // Decorrelated jitter: uniform in [base, 3 x previous], capped
+    int hi = std::max(p.base_ms + 1, std::min(p.cap_ms, b->delay_ms * 3));
+    b->delay_ms = std::min(p.cap_ms, g_random_int_range(p.base_ms, hi + 1));
+    return b->delay_ms;
+}
+
+std::string backoff_describe(const ReconnectBackoff* b) {
+    const int failures = b->failures[(int)b->last];
+    gchar* s = b->parked
+        ? g_strdup_printf("%s failure %d: parked for %d s", failure_kind_name(b->last), failures, b->delay_ms / 1000)
+        : g_strdup_printf("%s failure %d, retrying in %.1f s", failure_kind_name(b->last), failures,
+                          b->delay_ms / 1000.0);
+    std::string out(s);
+    g_free(s);
+    return out;
+}
@@ -0,0 +1,61 @@
+// backoff.h
+// Reconnect delays with decorrelated jitter, per failure class, and a circuit breaker.
+//
+// Plain doubling makes every camera behind the same link retry in lockstep after a blip, and the
+// NVR rejects the burst. Here each delay is drawn from [base, 3 x previous delay] and capped
+// ("decorrelated jitter"), so cameras that failed together spread out after the first retry.
+// Base, cap and breaker threshold depend on why the stream failed:
+//
+//   class     base    cap     park after   typical cause
+//   auth      30 s    10 min   3           401/403; retrying can lock the account
+//   dns       5 s     2 min   10           name does not resolve
+//   refused   2 s     1 min   20           camera up, RTSP port closed (rebooting)
+//   network   500 ms  30 s    30           timeouts, resets and everything else
+//   decoder   1 s     30 s     8           decoder errors (each one rules a decoder out)
+//   eos       250 ms  10 s    30           server ended the session
+//
+// Each class counts on its own, so three network errors do not bring a camera closer to the auth
+// threshold. After that many failures of one class without a frame the circuit opens: the camera
+// is parked for 5 min (doubling up to 30 min), then gets a single probe attempt. A frame closes the
+// circuit and resets everything, a failed probe parks it again right away.
+//
+// The class comes from the GError code (RESOURCE/NOT_AUTHORIZED) and, because rtspsrc reports
+// most connect failures as OPEN_READ_WRITE, from the text of the message; rtspsrc versions that
+// only say "Generic error" land in the network class.
+#pragma once
+
+#include <gst/gst.h>
+
+#include <atomic>
+#include <string>
+
+enum class FailureKind { Auth, Dns, Refused, Network, Decoder, Eos };
+static const int kFailureKinds = 6;
+
+struct ReconnectBackoff {
+    std::string name;
+    FailureKind last {FailureKind::Network};
+    int delay_ms {0};         // previous delay, 0 after a frame
+    int failures[kFailureKinds] {};  // per class, since the last frame
+    int parks {0};            // circuit openings in a row
+    bool parked {false};      // the last delay is a park
+    std::atomic<bool> streamed {false};  // set by the probe of backoff_watch()
+};
+
+void backoff_init(ReconnectBackoff* b, const std::string& name);
+
+// Marks a frame on the element's sink pad (the video sink, once per pipeline build) as recovery.
+void backoff_watch(ReconnectBackoff* b, GstElement* element);
+
+// Recovery seen by other means (a builder that already tracks frames).
+void backoff_success(ReconnectBackoff* b);
+
+// Class of an ERROR or EOS message; `from_decoder` for errors posted by the decode chain.
+FailureKind backoff_classify(GstMessage* msg, bool from_decoder);
+const char* failure_kind_name(FailureKind kind);
+
+// Delay before the next attempt after a failure of `kind` (a park when the circuit opens).
+int backoff_next(ReconnectBackoff* b, FailureKind kind);
+
+// "network failure 4, retrying in 2.7 s" / "auth failure 3: parked for 300 s"
+std::string backoff_describe(const ReconnectBackoff* b);
@@ -0,0 +1,324 @@
+// bus_dispatch.cpp
+#include "bus_dispatch.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+static std::mutex pool_mutex;
+static std::condition_variable pool_cv;
+static std::deque<BusStrand*> ready;  // strands with queued work, in arrival order
+static bool stopping = false;         // bus_dispatch_shutdown(): workers exit once `ready` is empty
+
+// Started by dispatcher(), joined by bus_dispatch_shutdown()
+static GMainLoop* dispatch_loop = nullptr;
+static std::thread dispatch_thread;
+static std::vector<std::thread> workers;
+
+static std::mutex registry_mutex;
+static std::vector<BusStrand*> registry;  // for the tick
+
+int bus_dispatch_workers() {
+    static const int n = [] {
+        const char* env = std::getenv("GRID_BUS_WORKERS");
+        int v = (env && *env) ? std::atoi(env) : 0;
+        if (v > 0) return v;
+        return std::max(2, std::min(4, (int)std::thread::hardware_concurrency() / 2));
+    }();
+    return n;
+}
+
+static void schedule(BusStrand* s) {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        ready.push_back(s);
+    }
+    pool_cv.notify_one();
+}
+
+// `if_idle`: only when nothing is queued or running (ticks do not pile up behind a slow task).
+static void enqueue(BusStrand* s, BusTask&& t, bool if_idle = false) {
+    {
+        std::lock_guard<std::mutex> lock(s->mu);
+        if (s->closed || (if_idle && s->busy)) {
+            if (t.msg) gst_message_unref(t.msg);
+            return;
+        }
+        t.generation = s->generation;
+        s->queue.push_back(std::move(t));
+        if (s->busy) return;
+        s->busy = true;
+    }
+    schedule(s);
+}
+
+// One task, then back to the end of the pool queue if more are waiting: a stream with a burst of
+// messages does not hold a worker while other streams wait.
+static void run_one(BusStrand* s) {
+    BusTask t;
+    bool stale = false;
+    {
+        std::lock_guard<std::mutex> lock(s->mu);
+        if (s->closed || s->queue.empty()) {
+            s->busy = false;
+            s->idle.notify_all();
+            return;
+        }
+        t = std::move(s->queue.front());
+        s->queue.pop_front();
+        stale = t.generation != s->generation;
+    }
+    if (t.msg) {
+        if (!stale) s->on_message(t.msg, s->user_data);
+        gst_message_unref(t.msg);
+    } else if (t.job) {
+        t.job();
+    }
+    {
+        std::lock_guard<std::mutex> lock(s->mu);
+        if (s->closed || s->queue.empty()) {
+            s->busy = false;
+            s->idle.notify_all();
+            return;
+        }
+    }
+    schedule(s);
+}
+
+static void worker_thread() {
+    for (;;) {
+        BusStrand* s = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(pool_mutex);
+            pool_cv.wait(lock, [] { return !ready.empty() || stopping; });
+            if (ready.empty()) return;
+            s = ready.front();
+            ready.pop_front();
+        }
+        run_one(s);
+    }
+}
+
+static gboolean tick_cb(gpointer) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (BusStrand* s : registry) {
+        if (!s->on_tick) continue;
+        BusTask t;
+        t.job = [s] { s->on_tick(s->user_data); };
+        enqueue(s, std::move(t), true);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+// The dispatcher and the pool start with the first strand and run until bus_dispatch_shutdown().
+static GMainContext* dispatcher() {
+    static GMainContext* ctx = [] {
+        GMainContext* c = g_main_context_new();
+        GSource* tick = g_timeout_source_new_seconds(1);
+        g_source_set_callback(tick, tick_cb, nullptr, nullptr);
+        g_source_attach(tick, c);
+        g_source_unref(tick);
+        dispatch_loop = g_main_loop_new(c, FALSE);
+        dispatch_thread = std::thread([c] {
+            g_main_context_push_thread_default(c);
+            g_main_loop_run(dispatch_loop);
+            g_main_context_pop_thread_default(c);
+        });
+        for (int i = 0; i < bus_dispatch_workers(); ++i) workers.emplace_back(worker_thread);
+        return c;
+    }();
+    return ctx;
+}
+
+struct SyncCall {
+    std::function<void()> fn;
+    std::mutex mu;
+    std::condition_variable cv;
+    bool done {false};
+};
+
+static gboolean sync_call_cb(gpointer data) {
+    SyncCall* c = static_cast<SyncCall*>(data);
+    c->fn();
+    {
+        std::lock_guard<std::mutex> lock(c->mu);
+        c->done = true;
+    }
+    c->cv.notify_all();
+    return G_SOURCE_REMOVE;
+}
+
+// Runs `fn` with the dispatcher context held: no watch or timer callback runs at the same time,
+// so a source destroyed here cannot still be calling into its strand afterwards.
+static void on_dispatcher(std::function<void()> fn) {
+    GMainContext* ctx = dispatcher();
+    if (g_main_context_is_owner(ctx)) {
+        fn();
+        return;
+    }
+    SyncCall c;
+    c.fn = std::move(fn);
+    g_main_context_invoke(ctx, sync_call_cb, &c);
+    std::unique_lock<std::mutex> lock(c.mu);
+    c.cv.wait(lock, [&c] { return c.done; });
+}
+
+static void drop_source(GSource** source) {
+    if (!*source) return;
+    g_source_destroy(*source);
+    g_source_unref(*source);
+    *source = nullptr;
+}
+
+static gboolean on_bus(GstBus* /*bus*/, GstMessage* msg, gpointer data) {
+    BusStrand* s = static_cast<BusStrand*>(data);
+    if (GST_MESSAGE_TYPE(msg) & s->types) {
+        BusTask t;
+        t.msg = gst_message_ref(msg);
+        enqueue(s, std::move(t));
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean on_timer(gpointer data) {
+    BusStrand* s = static_cast<BusStrand*>(data);
+    g_source_unref(s->timer);  // destroyed by returning G_SOURCE_REMOVE
+    s->timer = nullptr;
+    BusTask t;
+    t.job = std::move(s->delayed);
+    s->delayed = nullptr;
+    enqueue(s, std::move(t));
+    return G_SOURCE_REMOVE;
+}
+
+void bus_strand_init(BusStrand* s, const std::string& name, GstMessageType types, BusHandler on_message,
+                     BusTick on_tick, gpointer user_data) {
+    s->name = name;
+    s->types = types;
+    s->on_message = on_message;
+    s->on_tick = on_tick;
+    s->user_data = user_data;
+    dispatcher();
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    registry.push_back(s);
+}
+
+void bus_strand_flush(BusStrand* s) {
+    std::lock_guard<std::mutex> lock(s->mu);
+    ++s->generation;
+}
+
+void bus_strand_watch(BusStrand* s, GstElement* pipeline) {
+    GstBus* bus = gst_element_get_bus(pipeline);
+    on_dispatcher([s, bus] {
+        drop_source(&s->watch);
+        bus_strand_flush(s);  // before the first message of the new bus can be queued
+        s->watch = gst_bus_create_watch(bus);
+        g_source_set_callback(s->watch, (GSourceFunc)on_bus, s, nullptr);
+        g_source_attach(s->watch, dispatcher());
+    });
+    gst_object_unref(bus);
+}
+
+void bus_strand_unwatch(BusStrand* s) {
+    on_dispatcher([s] {
+        drop_source(&s->watch);
+        bus_strand_flush(s);
+    });
+}
+
+void bus_strand_post(BusStrand* s, std::function<void()> job) {
+    BusTask t;
+    t.job = std::move(job);
+    enqueue(s, std::move(t));
+}
+
+void bus_strand_post_after(BusStrand* s, int delay_ms, std::function<void()> job) {
+    on_dispatcher([s, delay_ms, &job] {
+        drop_source(&s->timer);
+        s->delayed = std::move(job);
+        s->timer = g_timeout_source_new((guint)std::max(delay_ms, 0));
+        g_source_set_callback(s->timer, on_timer, s, nullptr);
+        g_source_attach(s->timer, dispatcher());
+    });
+}
+
+void bus_strand_close(BusStrand* s) {
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry.erase(std::remove(registry.begin(), registry.end(), s), registry.end());
+    }
+    on_dispatcher([s] {
+        drop_source(&s->watch);
+        drop_source(&s->timer);
+        s->delayed = nullptr;
+    });
+    std::unique_lock<std::mutex> lock(s->mu);
+    s->closed = true;
+    s->idle.wait(lock, [s] { return !s->busy; });
+    for (BusTask& t : s->queue) {
+        if (t.msg) gst_message_unref(t.msg);
+    }
+    s->queue.clear();
+}
+
+struct Disposal {
+    GstElement* element;
+    std::function<void()> done;
+};
+
+static std::mutex dispose_mutex;
+static std::condition_variable dispose_cv;
+static int disposing = 0;
+
+static void dispose_one(gpointer data, gpointer) {
+    Disposal* d = static_cast<Disposal*>(data);
+    gst_element_set_state(d->element, GST_STATE_NULL);
+    gst_object_unref(d->element);
+    if (d->done) d->done();
+    delete d;
+    {
+        std::lock_guard<std::mutex> lock(dispose_mutex);
+        --disposing;
+    }
+    dispose_cv.notify_all();
+}
+
+void bus_dispatch_dispose(GstElement* element, std::function<void()> done) {
+    // Shared GLib threads: created on demand, idle ones exit on their own
+    static GThreadPool* pool = g_thread_pool_new(dispose_one, nullptr, 16, FALSE, nullptr);
+    {
+        std::lock_guard<std::mutex> lock(dispose_mutex);
+        ++disposing;
+    }
+    g_thread_pool_push(pool, new Disposal {element, std::move(done)}, nullptr);
+}
+
+void bus_dispatch_wait_disposed() {
+    std::unique_lock<std::mutex> lock(dispose_mutex);
+    dispose_cv.wait(lock, [] { return disposing == 0; });
+}
+
+static gboolean quit_cb(gpointer) {
+    g_main_loop_quit(dispatch_loop);
+    return G_SOURCE_REMOVE;
+}
+
+void bus_dispatch_shutdown() {
+    bus_dispatch_wait_disposed();
+    if (!dispatch_loop) return;  // no strand was ever created
+    // Through the context rather than g_main_loop_quit() here: the loop may not be running yet
+    GSource* quit = g_idle_source_new();
+    g_source_set_callback(quit, quit_cb, nullptr, nullptr);
+    g_source_attach(quit, dispatcher());
+    g_source_unref(quit);
+    dispatch_thread.join();
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        stopping = true;
+    }
+    pool_cv.notify_all();
+    for (std::thread& w : workers) w.join();
+    workers.clear();
+}
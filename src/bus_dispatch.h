@@ -0,0 +1,89 @@
+// bus_dispatch.h
+// One thread for the buses of every stream, and a small worker pool for the work they trigger.
+//
+// A thread per camera polling its bus every 200-250 ms wakes N x 4-5 times a second for nothing,
+// reacts to an ERROR only at the next poll and sits in backoff sleeps and set_state() calls. Here
+// a single dispatcher thread runs a GMainContext holding one bus watch per pipeline (woken through
+// the bus fd when a message is posted) and one timer per pending retry. It never handles anything
+// itself: messages and expired timers are queued on the stream's strand and run on a fixed pool
+// of workers ($GRID_BUS_WORKERS, default 2-4 by core count).
+//
+// A strand runs the messages, delayed jobs and ticks of one stream one at a time, in order, so a
+// handler never races its own stream's reconnect; different streams run in parallel. Messages
+// queued before the pipeline was replaced (bus_strand_watch/unwatch/flush) are dropped unhandled.
+// The thread count stays at 1 + workers however many cameras there are.
+//
+// Stopping a pipeline is the one step that still blocks (rtspsrc's TEARDOWN): bus_dispatch_dispose()
+// runs it on a separate pool, so neither a strand nor the caller waits for it.
+#pragma once
+
+#include <gst/gst.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+typedef void (*BusHandler)(GstMessage* msg, gpointer user_data);
+typedef void (*BusTick)(gpointer user_data);
+
+struct BusTask {
+    GstMessage* msg {nullptr};   // a bus message, or
+    std::function<void()> job;   // a posted job
+    guint generation {0};
+};
+
+struct BusStrand {
+    std::string name;
+    GstMessageType types {GST_MESSAGE_ANY};  // messages worth queueing
+    BusHandler on_message {nullptr};
+    BusTick on_tick {nullptr};               // about once a second while idle (optional)
+    gpointer user_data {nullptr};
+
+    // Dispatcher thread only
+    GSource* watch {nullptr};
+    GSource* timer {nullptr};
+    std::function<void()> delayed;
+
+    std::mutex mu;
+    std::condition_variable idle;
+    std::deque<BusTask> queue;
+    guint generation {0};  // bumped when the pipeline changes; older queued messages are dropped
+    bool busy {false};     // waiting for or running on a worker
+    bool closed {false};
+};
+
+void bus_strand_init(BusStrand* s, const std::string& name, GstMessageType types, BusHandler on_message,
+                     BusTick on_tick, gpointer user_data);
+
+// Watch the bus of `pipeline` (replacing the previous watch); call after every build.
+void bus_strand_watch(BusStrand* s, GstElement* pipeline);
+// Stop watching before the pipeline is torn down.
+void bus_strand_unwatch(BusStrand* s);
+// Drop the messages already queued (the source was swapped inside the same pipeline).
+void bus_strand_flush(BusStrand* s);
+
+// Run `job` on the strand, after the work already queued.
+void bus_strand_post(BusStrand* s, std::function<void()> job);
+// Run `job` on the strand after `delay_ms`; replaces a delayed job that has not run yet.
+void bus_strand_post_after(BusStrand* s, int delay_ms, std::function<void()> job);
+
+// Cancel the watch and the delayed job, wait for the running task, drop the rest. Not from a
+// task of the same strand.
+void bus_strand_close(BusStrand* s);
+
+// Pool size from $GRID_BUS_WORKERS.
+int bus_dispatch_workers();
+
+// Set `element` to NULL and drop the caller's reference on a separate GLib thread pool (up to 16
+// at once): rtspsrc sends TEARDOWN on the way down, which blocks for seconds on a dead camera.
+// `done` (optional) runs on the pool thread afterwards, e.g. to post the rebuild to a strand.
+void bus_dispatch_dispose(GstElement* element, std::function<void()> done = nullptr);
+
+// Wait for every disposal started so far (before exit, or before freeing what their probes use).
+void bus_dispatch_wait_disposed();
+
+// Before gst_deinit(): wait for the disposals, then stop and join the dispatcher and the workers.
+// Close every strand first; none may be used afterwards.
+void bus_dispatch_shutdown();
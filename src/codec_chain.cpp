@@ -0,0 +1,477 @@
+// codec_chain.cpp
+#include "codec_chain.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+
+#include "decoder_bench.h"
+#include "metrics.h"
+
+struct CodecInfo {
+    const char* encoding;
+    const char* depay;
+    const char* parser;
+    const char* decoders;  // ranked, hardware first
+};
+
+static const CodecInfo kCodecs[] = {
+    { "H264", "rtph264depay", "h264parse",
+      "v4l2slh264dec,v4l2h264dec,vah264dec,vaapih264dec,nvh264dec,d3d11h264dec,avdec_h264,openh264dec" },
+    { "H265", "rtph265depay", "h265parse",
+      "v4l2slh265dec,v4l2h265dec,vah265dec,vaapih265dec,nvh265dec,d3d11h265dec,avdec_h265,libde265dec" },
+    { "JPEG", "rtpjpegdepay", "jpegparse",
+      "v4l2jpegdec,vajpegdec,nvjpegdec,jpegdec,avdec_mjpeg" },
+};
+
+static const CodecInfo* codec_info(const std::string& encoding) {
+    for (const CodecInfo& c : kCodecs) {
+        if (g_ascii_strcasecmp(c.encoding, encoding.c_str()) == 0) return &c;
+    }
+    return nullptr;
+}
+
+static std::vector<std::string> split_list(const char* list) {
+    std::vector<std::string> out;
+    std::istringstream iss(list);
+    for (std::string item; std::getline(iss, item, ','); ) {
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
+static bool factory_exists(const std::string& name) {
+    GstElementFactory* f = gst_element_factory_find(name.c_str());
+    if (!f) return false;
+    gst_object_unref(f);
+    return true;
+}
+
+static bool is_hardware_decoder(const std::string& name) {
+    GstElementFactory* f = gst_element_factory_find(name.c_str());
+    if (!f) return false;
+    const gchar* klass = gst_element_factory_get_metadata(f, GST_ELEMENT_METADATA_KLASS);
+    bool hw = klass && strstr(klass, "Hardware");
+    gst_object_unref(f);
+    return hw;
+}
+
+std::vector<std::string> codec_decoder_ranking(const std::string& encoding, bool prefer_software) {
+    const CodecInfo* info = codec_info(encoding);
+    if (!info) return {};
+    std::string env_name = "GRID_DECODERS_" + std::string(info->encoding);
+    const char* env = std::getenv(env_name.c_str());
+    if (env && *env) return split_list(env);
+
+    std::vector<std::string> ranked = split_list(info->decoders);
+    std::vector<std::string> measured;
+    if (decoder_bench_ranking(info->encoding, measured)) {
+        // Calibrated on this box: measured order first, the rest (failed on the test clip, not
+        // installed) keep their built-in order behind it
+        for (const std::string& d : ranked) {
+            if (std::find(measured.begin(), measured.end(), d) == measured.end()) measured.push_back(d);
+        }
+        return measured;
+    }
+    if (prefer_software) {
+        std::stable_partition(ranked.begin(), ranked.end(),
+                              [](const std::string& n) { return !is_hardware_decoder(n); });
+    }
+    return ranked;
+}
+
+std::vector<std::string> codec_builtin_decoders(const std::string& encoding) {
+    const CodecInfo* info = codec_info(encoding);
+    return info ? split_list(info->decoders) : std::vector<std::string>{};
+}
+
+const char* codec_parser_name(const std::string& encoding) {
+    const CodecInfo* info = codec_info(encoding);
+    return info ? info->parser : "";
+}
+
+bool fast_reconnect_enabled() {
+    static const bool enabled = [] {
+        const char* env = std::getenv("GRID_FAST_RECONNECT");
+        return !(env && std::strcmp(env, "0") == 0);
+    }();
+    return enabled;
+}
+
+std::string rtp_encoding_name(GstPad* pad) {
+    std::string enc;
+    GstCaps* caps = gst_pad_get_current_caps(pad);
+    if (!caps) caps = gst_pad_query_caps(pad, nullptr);
+    if (!caps) return enc;
+    if (gst_caps_get_size(caps) > 0) {
+        const GstStructure* st = gst_caps_get_structure(caps, 0);
+        const gchar* e = gst_structure_get_string(st, "encoding-name");
+        if (e) enc = e;
+    }
+    gst_caps_unref(caps);
+    return enc;
+}
+
+std::string codec_chain_describe(const CodecChain& chain) {
+    std::string s = chain.depay;
+    if (!chain.parser.empty()) s += " ! " + chain.parser;
+    s += " ! " + chain.decoder;
+    return s;
+}
+
+// Depayloader and parser for `encoding` plus the given decoder; the parser is left out when it
+// is not installed (jpegparse lives in -bad).
+static bool chain_for(const std::string& encoding, const std::string& decoder, CodecChain& out) {
+    const CodecInfo* info = codec_info(encoding);
+    if (!info) return false;
+    out.encoding = info->encoding;
+    out.depay = info->depay;
+    out.parser = factory_exists(info->parser) ? info->parser : "";
+    out.decoder = decoder;
+    return true;
+}
+
+// ---- Remembered choices: <user cache>/gstreamer-rtsp-grid/decoders.ini ----
+
+static std::mutex choice_mutex;
+
+static std::string choice_path() {
+    gchar* path = g_build_filename(g_get_user_cache_dir(), "gstreamer-rtsp-grid", "decoders.ini", NULL);
+    std::string s = path;
+    g_free(path);
+    return s;
+}
+
+// "cam1 3f2a91c0": camera name plus a hash of the URL, so main and sub stream are kept apart and
+// a changed URL starts over.
+static std::string choice_group(const std::string& name, const std::string& url) {
+    gchar* sum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, url.c_str(), -1);
+    std::string group = name + " " + std::string(sum, 8);
+    g_free(sum);
+    return group;
+}
+
+static bool choice_load(const std::string& name, const std::string& url, CodecChain& out) {
+    std::lock_guard<std::mutex> lock(choice_mutex);
+    GKeyFile* kf = g_key_file_new();
+    bool ok = false;
+    if (g_key_file_load_from_file(kf, choice_path().c_str(), G_KEY_FILE_NONE, nullptr)) {
+        std::string group = choice_group(name, url);
+        gchar* enc = g_key_file_get_string(kf, group.c_str(), "encoding", nullptr);
+        gchar* dec = g_key_file_get_string(kf, group.c_str(), "decoder", nullptr);
+        if (enc && dec && factory_exists(dec)) ok = chain_for(enc, dec, out);
+        g_free(enc);
+        g_free(dec);
+    }
+    g_key_file_free(kf);
+    return ok;
+}
+
+static void choice_save(GKeyFile* kf) {
+    std::string path = choice_path();
+    gchar* dir = g_path_get_dirname(path.c_str());
+    g_mkdir_with_parents(dir, 0755);
+    g_free(dir);
+    GError* err = nullptr;
+    if (!g_key_file_save_to_file(kf, path.c_str(), &err)) {
+        g_printerr("Cannot write %s: %s\n", path.c_str(), err ? err->message : "");
+    }
+    if (err) g_error_free(err);
+}
+
+static void choice_store(const std::string& name, const std::string& url, const CodecChain& chain) {
+    std::lock_guard<std::mutex> lock(choice_mutex);
+    GKeyFile* kf = g_key_file_new();
+    g_key_file_load_from_file(kf, choice_path().c_str(), G_KEY_FILE_KEEP_COMMENTS, nullptr);
+    std::string group = choice_group(name, url);
+    gchar* old = g_key_file_get_string(kf, group.c_str(), "decoder", nullptr);
+    if (g_strcmp0(old, chain.decoder.c_str()) != 0) {
+        g_key_file_set_string(kf, group.c_str(), "encoding", chain.encoding.c_str());
+        g_key_file_set_string(kf, group.c_str(), "decoder", chain.decoder.c_str());
+        choice_save(kf);
+    }
+    g_free(old);
+    g_key_file_free(kf);
+}
+
+static void choice_forget(const std::string& name, const std::string& url) {
+    std::lock_guard<std::mutex> lock(choice_mutex);
+    GKeyFile* kf = g_key_file_new();
+    if (g_key_file_load_from_file(kf, choice_path().c_str(), G_KEY_FILE_KEEP_COMMENTS, nullptr) &&
+        g_key_file_remove_group(kf, choice_group(name, url).c_str(), nullptr)) {
+        choice_save(kf);
+    }
+    g_key_file_free(kf);
+}
+
+void codec_chain_forget_choices(const std::string& encoding) {
+    std::lock_guard<std::mutex> lock(choice_mutex);
+    GKeyFile* kf = g_key_file_new();
+    if (g_key_file_load_from_file(kf, choice_path().c_str(), G_KEY_FILE_KEEP_COMMENTS, nullptr)) {
+        bool changed = false;
+        gchar** groups = g_key_file_get_groups(kf, nullptr);
+        for (gchar** g = groups; g && *g; ++g) {
+            gchar* enc = g_key_file_get_string(kf, *g, "encoding", nullptr);
+            if (enc && g_ascii_strcasecmp(enc, encoding.c_str()) == 0) {
+                g_key_file_remove_group(kf, *g, nullptr);
+                changed = true;
+            }
+            g_free(enc);
+        }
+        g_strfreev(groups);
+        if (changed) choice_save(kf);
+    }
+    g_key_file_free(kf);
+}
+
+// ---- Building the chain ----
+
+// Decoder src pad, first buffer: this decoder works for this camera. Only flagged here; the file is
+// written by decode_chain_commit() on the owner's thread, not while the stream waits.
+static GstPadProbeReturn on_first_decoded(GstPad* /*pad*/, GstPadProbeInfo* /*info*/, gpointer user_data) {
+    static_cast<DecodeChain*>(user_data)->first_decoded.store(true);
+    return GST_PAD_PROBE_REMOVE;
+}
+
+static bool is_failed(const DecodeChain* dc, const std::string& decoder) {
+    return std::find(dc->failed.begin(), dc->failed.end(), decoder) != dc->failed.end();
+}
+
+// Creates and links depay ! [parser !] dec ! downstream inside `bin`. Nothing is left behind on
+// failure (a decoder whose caps cannot link is simply skipped by the caller).
+static bool build_chain(DecodeChain* dc, GstBin* bin, const CodecChain& chain, GstElement* downstream) {
+    GstElement* depay  = gst_element_factory_make(chain.depay.c_str(), (dc->name + "_depay").c_str());
+    GstElement* parser = chain.parser.empty() ? nullptr
+                       : gst_element_factory_make(chain.parser.c_str(), (dc->name + "_parse").c_str());
+    GstElement* dec    = gst_element_factory_make(chain.decoder.c_str(), (dc->name + "_dec").c_str());
+    if (!depay || !dec || (!chain.parser.empty() && !parser)) {
+        // Still floating, nobody else owns them
+        if (depay) gst_object_unref(depay);
+        if (parser) gst_object_unref(parser);
+        if (dec) gst_object_unref(dec);
+        return false;
+    }
+
+    // Stateful V4L2 decoders hand out mmap'ed buffers unless asked for dmabufs; the others either
+    // negotiate memory:DMABuf caps or have nothing to export
+    if (dc->dmabuf_output && g_object_class_find_property(G_OBJECT_GET_CLASS(dec), "capture-io-mode")) {
+        gst_util_set_object_arg(G_OBJECT(dec), "capture-io-mode", "dmabuf");
+    }
+
+    gst_bin_add_many(bin, depay, dec, NULL);
+    if (parser) gst_bin_add(bin, parser);
+    bool linked = parser ? gst_element_link_many(depay, parser, dec, downstream, NULL)
+                         : gst_element_link_many(depay, dec, downstream, NULL);
+    if (!linked) {
+        gst_bin_remove(bin, depay);
+        gst_bin_remove(bin, dec);
+        if (parser) gst_bin_remove(bin, parser);
+        return false;
+    }
+
+    dc->chain = chain;
+    dc->depay = depay;
+    dc->parser = parser;
+    dc->dec = dec;
+    dc->stale = false;
+    dc->first_decoded = false;
+
+    GstPad* out = gst_element_get_static_pad(dec, "src");
+    if (out) {
+        gst_pad_add_probe(out, GST_PAD_PROBE_TYPE_BUFFER, on_first_decoded, dc, nullptr);
+        gst_object_unref(out);
+    }
+    stream_metrics_watch_decoder(dc->metrics, dec);
+    return true;
+}
+
+static void discard_chain(DecodeChain* dc, GstBin* bin) {
+    GstElement* elems[] = { dc->dec, dc->parser, dc->depay };
+    for (GstElement* e : elems) {
+        if (!e) continue;
+        gst_element_set_state(e, GST_STATE_NULL);
+        gst_bin_remove(bin, e);
+    }
+    decode_chain_reset(dc);
+}
+
+// The remembered decoder first (unless it failed), then the ranking.
+static bool select_and_build(DecodeChain* dc, GstBin* bin, const std::string& encoding, GstElement* downstream) {
+    std::vector<std::string> candidates;
+    if (dc->chain.valid() && g_ascii_strcasecmp(dc->chain.encoding.c_str(), encoding.c_str()) == 0) {
+        candidates.push_back(dc->chain.decoder);
+    }
+    for (const std::string& d : codec_decoder_ranking(encoding, dc->prefer_software)) {
+        if (std::find(candidates.begin(), candidates.end(), d) == candidates.end()) candidates.push_back(d);
+    }
+
+    for (const std::string& d : candidates) {
+        if (is_failed(dc, d) || !factory_exists(d)) continue;
+        CodecChain chain;
+        if (!chain_for(encoding, d, chain)) break;
+        if (build_chain(dc, bin, chain, downstream)) {
+            g_print("[%s] %s: %s\n", dc->name.c_str(), chain.encoding.c_str(), codec_chain_describe(chain).c_str());
+            return true;
+        }
+        g_printerr("[%s] %s does not link for %s, trying next\n", dc->name.c_str(), d.c_str(), encoding.c_str());
+    }
+    return false;
+}
+
+void decode_chain_init(DecodeChain* dc, const std::string& name, const std::string& url, bool prefer_software) {
+    dc->name = name;
+    dc->url = url;
+    dc->prefer_software = prefer_software;
+    dc->chain = CodecChain{};
+    choice_load(name, url, dc->chain);
+}
+
+bool decode_chain_prebuild(DecodeChain* dc, GstBin* bin, GstElement* downstream) {
+    std::lock_guard<std::mutex> lock(dc->mutex);
+    if (!dc->chain.valid() || dc->depay || is_failed(dc, dc->chain.decoder)) return false;
+    CodecChain chain = dc->chain;
+    return build_chain(dc, bin, chain, downstream);
+}
+
+bool decode_chain_link_pad(DecodeChain* dc, GstBin* bin, GstPad* pad, GstElement* downstream) {
+    std::lock_guard<std::mutex> lock(dc->mutex);
+    std::string enc = rtp_encoding_name(pad);
+    if (enc.empty()) enc = dc->chain.encoding;
+
+    if (dc->depay && (dc->stale || g_ascii_strcasecmp(enc.c_str(), dc->chain.encoding.c_str()) != 0)) {
+        if (!dc->stale) {
+            g_print("[%s] Codec changed %s -> %s\n", dc->name.c_str(), dc->chain.encoding.c_str(), enc.c_str());
+        }
+        discard_chain(dc, bin);
+    }
+    if (!dc->depay) {
+        if (!codec_info(enc)) {
+            g_printerr("[%s] Unsupported codec: %s\n", dc->name.c_str(), enc.empty() ? "(unknown)" : enc.c_str());
+            return false;
+        }
+        if (!select_and_build(dc, bin, enc, downstream)) {
+            g_printerr("[%s] No usable %s decoder\n", dc->name.c_str(), enc.c_str());
+            dc->failed.clear();  // the next reconnect tries the whole list again
+            return false;
+        }
+        // Downstream first so nothing pushes into an element that is not running yet
+        gst_element_sync_state_with_parent(dc->dec);
+        if (dc->parser) gst_element_sync_state_with_parent(dc->parser);
+        gst_element_sync_state_with_parent(dc->depay);
+    }
+
+    GstPad* sinkpad = gst_element_get_static_pad(dc->depay, "sink");
+    if (!sinkpad) return false;
+    bool ok = true;
+    if (!gst_pad_is_linked(sinkpad)) {
+        GstPadLinkReturn ret = gst_pad_link(pad, sinkpad);
+        if (ret != GST_PAD_LINK_OK) {
+            g_printerr("[%s] Failed to link rtspsrc->%s: %d\n", dc->name.c_str(), dc->chain.depay.c_str(), ret);
+            ok = false;
+        } else {
+            stream_metrics_watch_ingress(dc->metrics, pad);
+        }
+    }
+    gst_object_unref(sinkpad);
+    return ok;
+}
+
+bool decode_chain_is_decoder(const DecodeChain* dc, GstObject* obj) {
+    std::lock_guard<std::mutex> lock(dc->mutex);
+    return dc->dec && obj && gst_object_has_as_ancestor(obj, GST_OBJECT(dc->dec));
+}
+
+void decode_chain_commit(DecodeChain* dc) {
+    if (!dc->first_decoded.exchange(false)) return;
+    CodecChain chain;
+    {
+        std::lock_guard<std::mutex> lock(dc->mutex);
+        chain = dc->chain;  // still set after decode_chain_reset(): the pipeline may be gone already
+    }
+    choice_store(dc->name, dc->url, chain);
+}
+
+void decode_chain_mark_failed(DecodeChain* dc) {
+    {
+        std::lock_guard<std::mutex> lock(dc->mutex);
+        if (!dc->chain.valid()) return;
+        g_printerr("[%s] Decoder %s failed; trying the next one\n", dc->name.c_str(), dc->chain.decoder.c_str());
+        if (!is_failed(dc, dc->chain.decoder)) dc->failed.push_back(dc->chain.decoder);
+        dc->stale = true;
+    }
+    choice_forget(dc->name, dc->url);
+}
+
+void decode_chain_reset(DecodeChain* dc) {
+    std::lock_guard<std::mutex> lock(dc->mutex);
+    dc->depay = dc->parser = dc->dec = nullptr;
+    dc->stale = false;
+}
+
+bool codec_chain_message_is_stale(GstElement* pipeline, GstMessage* msg) {
+    GstObject* src = GST_MESSAGE_SRC(msg);
+    return src && src != GST_OBJECT(pipeline) && !gst_object_has_as_ancestor(src, GST_OBJECT(pipeline));
+}
+
+GstElement* codec_chain_swap_source(GstElement* pipeline, GstElement* old_src, GstElement* head,
+                                    GstElement** removed) {
+    gchar* name = gst_object_get_name(GST_OBJECT(old_src));
+    gchar* location = nullptr;
+    guint latency = 0;
+    guint protocols = 0;
+    g_object_get(G_OBJECT(old_src), "location", &location, "latency", &latency, "protocols", &protocols, NULL);
+
+    // A late pad of the old source must not link into `head` before the new source gets there
+    g_signal_handlers_disconnect_matched(old_src, G_SIGNAL_MATCH_ID, g_signal_lookup("pad-added", GST_TYPE_ELEMENT),
+                                         0, nullptr, nullptr, nullptr);
+    if (removed) {
+        *removed = GST_ELEMENT(gst_object_ref(old_src));  // still running; the caller stops it
+    } else {
+        gst_element_set_state(old_src, GST_STATE_NULL);
+    }
+    gst_bin_remove(GST_BIN(pipeline), old_src);  // unlinks its pads
+
+    // EOS (server closed the session) has already reached the sink; clear it without resetting
+    // the pipeline clock so the new source's timestamps line up with the running time.
+    GstPad* sinkpad = gst_element_get_static_pad(head, "sink");
+    if (sinkpad) {
+        gst_pad_send_event(sinkpad, gst_event_new_flush_start());
+        gst_pad_send_event(sinkpad, gst_event_new_flush_stop(FALSE));
+        gst_object_unref(sinkpad);
+    }
+
+    GstElement* src = gst_element_factory_make("rtspsrc", name);
+    if (src) {
+        g_object_set(G_OBJECT(src), "location", location, "latency", latency, "protocols", protocols, NULL);
+        gst_bin_add(GST_BIN(pipeline), src);
+    }
+    g_free(location);
+    g_free(name);
+    return src;
+}
+
+static GstPadProbeReturn on_first_buffer(GstPad* /*pad*/, GstPadProbeInfo* /*info*/, gpointer user_data) {
+    FirstFrameTimer* t = static_cast<FirstFrameTimer*>(user_data);
+    if (t->armed_us.load(std::memory_order_relaxed) == 0) return GST_PAD_PROBE_OK;
+    gint64 armed = t->armed_us.exchange(0);
+    if (armed) t->result_ms.store((g_get_monotonic_time() - armed) / 1000);
+    return GST_PAD_PROBE_OK;
+}
+
+void first_frame_timer_attach(FirstFrameTimer* t, GstElement* element) {
+    GstPad* pad = gst_element_get_static_pad(element, "sink");
+    if (!pad) return;
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, on_first_buffer, t, nullptr);
+    gst_object_unref(pad);
+}
+
+void first_frame_timer_arm(FirstFrameTimer* t) {
+    t->result_ms.store(-1);
+    t->armed_us.store(g_get_monotonic_time());
+}
+
+gint64 first_frame_timer_take(FirstFrameTimer* t) {
+    return t->result_ms.exchange(-1);
+}
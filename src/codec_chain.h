@@ -0,0 +1,126 @@
+// codec_chain.h
+// Codec dispatch: depayloader ! parser ! decoder picked from the RTP encoding-name, without
+// decodebin.
+//
+// rtspsrc knows the codec from the SDP before the first packet arrives, so the chain is created
+// in its "pad-added" handler (or right away when the camera's codec is remembered from an earlier
+// run) and no typefinding or autoplugging happens. Decoders are tried in a ranked list per codec;
+// the one that decoded the first frame for a camera is stored in the user cache directory and is
+// tried first on the next launch. A decoder that errors at runtime is skipped for that camera.
+//
+// Threads: pad-added builds and replaces the chain on rtspsrc's streaming thread, while the owner
+// (bus strand or main loop) asks which element failed and marks decoders failed, so the chain and
+// its element pointers are guarded by DecodeChain::mutex. The decoder probe only flags the first
+// frame; the owner writes the cache file from decode_chain_commit().
+#pragma once
+
+#include <gst/gst.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Factory names of one camera's decode chain.
+struct CodecChain {
+    std::string encoding;  // RTP encoding-name ("H264", "H265", "JPEG")
+    std::string depay;
+    std::string parser;    // may be empty (jpegparse is optional)
+    std::string decoder;
+
+    bool valid() const { return !depay.empty() && !decoder.empty(); }
+};
+
+struct StreamMetrics;
+
+// The chain of one camera inside its pipeline (or mosaic tile bin).
+struct DecodeChain {
+    std::string name;               // camera name: element names, log prefix, cache key
+    std::string url;                // cache key (hashed, credentials are not stored)
+    bool prefer_software {false};   // rank avdec_* / jpegdec above hardware decoders
+    bool dmabuf_output {false};     // V4L2 decoders export their buffers as dmabufs (DRM grid import)
+
+    CodecChain chain;               // current selection, or the remembered one before connecting
+    std::vector<std::string> failed;  // decoders that errored for this camera
+    bool stale {false};             // rebuild on the next pad-added (decoder failed)
+
+    GstElement* depay {nullptr};    // elements currently in the bin
+    GstElement* parser {nullptr};
+    GstElement* dec {nullptr};
+
+    StreamMetrics* metrics {nullptr};  // optional: probes on every source pad and decoder
+
+    std::atomic<bool> first_decoded {false};  // set by the decoder probe, cleared by decode_chain_commit()
+    mutable std::mutex mutex;       // chain, failed, stale and the element pointers
+};
+
+// Ranked decoder factories for an encoding-name: $GRID_DECODERS_<ENC> (comma separated), else the
+// order measured by decoder_bench_calibrate(), else the built-in list (hardware first, or software
+// first with `prefer_software`). Empty for unsupported codecs.
+std::vector<std::string> codec_decoder_ranking(const std::string& encoding, bool prefer_software);
+
+// Built-in ranked decoders and the parser factory for an encoding-name, without overrides or
+// calibration applied (used by the decoder calibration itself).
+std::vector<std::string> codec_builtin_decoders(const std::string& encoding);
+const char* codec_parser_name(const std::string& encoding);
+
+// GRID_FAST_RECONNECT=0 always rebuilds the whole pipeline (for before/after comparisons).
+bool fast_reconnect_enabled();
+
+// "encoding-name" of an rtspsrc pad; empty if the caps do not carry one.
+std::string rtp_encoding_name(GstPad* pad);
+
+// "rtph265depay ! h265parse ! avdec_h265"
+std::string codec_chain_describe(const CodecChain& chain);
+
+// Sets name/url/preference and loads the decoder remembered for this camera, if any.
+void decode_chain_init(DecodeChain* dc, const std::string& name, const std::string& url, bool prefer_software);
+
+// Builds the remembered chain into `bin` ahead of the connect and links it to `downstream`.
+// Returns false (and builds nothing) when no chain is known yet.
+bool decode_chain_prebuild(DecodeChain* dc, GstBin* bin, GstElement* downstream);
+
+// rtspsrc "pad-added": reuse the chain if it matches the pad's encoding, otherwise replace it
+// with the best available decoder for that encoding, then link `pad` to the depayloader.
+bool decode_chain_link_pad(DecodeChain* dc, GstBin* bin, GstPad* pad, GstElement* downstream);
+
+// True if `obj` is (inside) the current decoder.
+bool decode_chain_is_decoder(const DecodeChain* dc, GstObject* obj);
+
+// Owner thread (bus tick, strand or main-loop timer): once the current decoder has decoded its first
+// frame, remember it for this camera.
+void decode_chain_commit(DecodeChain* dc);
+
+// The current decoder failed: skip it for this camera and rebuild on the next pad-added.
+void decode_chain_mark_failed(DecodeChain* dc);
+
+// Drop every camera's remembered decoder for `encoding` (the ranking changed).
+void codec_chain_forget_choices(const std::string& encoding);
+
+// Forget the element pointers after the owning pipeline/bin was destroyed.
+void decode_chain_reset(DecodeChain* dc);
+
+// Replace `old_src` by a new rtspsrc with the same name, location, latency and protocols, flush
+// `head` (first element after the source) so an EOS that already went downstream is cleared. The
+// old source's "pad-added" handlers are disconnected. The new source is added to `pipeline` but
+// not linked or started: connect its "pad-added" handler, then call
+// gst_element_sync_state_with_parent(). nullptr on failure. Messages the old source queued on the
+// pipeline bus still arrive: skip them with codec_chain_message_is_stale().
+// With `removed`, the old source is not stopped here (its TEARDOWN can block for seconds on a dead
+// camera): it is unlinked and handed back, still running, for the caller to stop elsewhere.
+GstElement* codec_chain_swap_source(GstElement* pipeline, GstElement* old_src, GstElement* head,
+                                    GstElement** removed = nullptr);
+// True when `msg` comes from an element that is no longer inside `pipeline` (a swapped-out source).
+bool codec_chain_message_is_stale(GstElement* pipeline, GstMessage* msg);
+
+// Time from (re)connect to the first buffer reaching the sink.
+struct FirstFrameTimer {
+    std::atomic<gint64> armed_us {0};  // g_get_monotonic_time() when armed, 0 = idle
+    std::atomic<gint64> result_ms {-1};
+};
+
+// Probe the "sink" pad of `element` (the video sink).
+void first_frame_timer_attach(FirstFrameTimer* t, GstElement* element);
+void first_frame_timer_arm(FirstFrameTimer* t);
+// Milliseconds of the last completed measurement, -1 if none since the last call.
+gint64 first_frame_timer_take(FirstFrameTimer* t);
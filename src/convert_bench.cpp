@@ -0,0 +1,166 @@
+// convert_bench.cpp
+// Scale+convert microbenchmark: the post-decode stage of a software-decoded tile, without the
+// decoder. One frame at the camera size (default 2560x1440 I420, what avdec_h265 gives for the
+// main streams) is repeated by imagefreeze through the stage into BGRx at the tile size, as
+// gtksink takes it, on N streams at once. Prints frames/s and CPU time per frame.
+//
+//   grid_convert_bench [--streams N] [--frames F] [--size WxH] [--tile WxH] [--format I420|NV12]
+//                      [--threads T] [--legacy]
+//
+// Default is convert_chain (convert_chain.h) with $GRID_CONVERT_THREADS or the cores shared out
+// between the streams; --threads overrides. --legacy measures the previous gtk_opt/kms chain:
+// videoscale method=1 ! capsfilter(I420 at the tile size) ! videoconvert, one thread each.
+#include <gst/gst.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "convert_chain.h"
+#include "proc_stats.h"
+
+struct BenchOptions {
+    int streams {1};
+    int frames {300};
+    int width {2560};
+    int height {1440};
+    int tile_w {960};
+    int tile_h {540};
+    std::string format {"I420"};
+    int threads {0};  // 0: convert_chain_threads(streams)
+    bool legacy {false};
+};
+
+static bool parse_size(const char* s, int& w, int& h) {
+    return std::sscanf(s, "%dx%d", &w, &h) == 2 && w > 0 && h > 0;
+}
+
+static bool parse_args(int argc, char** argv, BenchOptions& o) {
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (std::strcmp(a, "--streams") == 0 && has_value) o.streams = std::atoi(argv[++i]);
+        else if (std::strcmp(a, "--frames") == 0 && has_value) o.frames = std::atoi(argv[++i]);
+        else if (std::strcmp(a, "--size") == 0 && has_value) { if (!parse_size(argv[++i], o.width, o.height)) return false; }
+        else if (std::strcmp(a, "--tile") == 0 && has_value) { if (!parse_size(argv[++i], o.tile_w, o.tile_h)) return false; }
+        else if (std::strcmp(a, "--format") == 0 && has_value) o.format = argv[++i];
+        else if (std::strcmp(a, "--threads") == 0 && has_value) o.threads = std::atoi(argv[++i]);
+        else if (std::strcmp(a, "--legacy") == 0) o.legacy = true;
+        else return false;
+    }
+    return o.streams > 0 && o.frames > 0;
+}
+
+// capsfilter: `format`, plus the size and rate when given
+static GstElement* make_caps(const char* format, int w = 0, int h = 0, int fps = 0) {
+    GstElement* capsf = gst_element_factory_make("capsfilter", nullptr);
+    GstCaps* caps = gst_caps_new_simple("video/x-raw", "format", G_TYPE_STRING, format, NULL);
+    if (w) gst_caps_set_simple(caps, "width", G_TYPE_INT, w, "height", G_TYPE_INT, h, NULL);
+    if (fps) gst_caps_set_simple(caps, "framerate", GST_TYPE_FRACTION, fps, 1, NULL);
+    g_object_set(G_OBJECT(capsf), "caps", caps, NULL);
+    gst_caps_unref(caps);
+    return capsf;
+}
+
+// videotestsrc num-buffers=1 ! camera caps ! imagefreeze num-buffers=F ! stage ! BGRx ! fakesink
+static GstElement* build(const BenchOptions& o, int index, int threads) {
+    const std::string name = "bench" + std::to_string(index + 1);
+    GstElement* pipeline = gst_pipeline_new((name + "_pipe").c_str());
+    GstElement* src = gst_element_factory_make("videotestsrc", nullptr);
+    GstElement* freeze = gst_element_factory_make("imagefreeze", nullptr);
+    GstElement* sink = gst_element_factory_make("fakesink", nullptr);
+    if (!src || !freeze || !sink) {
+        g_printerr("[%s] Failed to create videotestsrc/imagefreeze/fakesink\n", name.c_str());
+        return nullptr;
+    }
+    g_object_set(G_OBJECT(src), "num-buffers", 1, "pattern", index % 20, NULL);
+    g_object_set(G_OBJECT(freeze), "num-buffers", o.frames, NULL);
+    g_object_set(G_OBJECT(sink), "sync", FALSE, NULL);
+
+    std::vector<GstElement*> chain {src, make_caps(o.format.c_str(), o.width, o.height, 25), freeze};
+    if (o.legacy) {
+        GstElement* scale = gst_element_factory_make("videoscale", nullptr);
+        GstElement* conv = gst_element_factory_make("videoconvert", nullptr);
+        if (!scale || !conv) return nullptr;
+        g_object_set(G_OBJECT(scale), "method", 1, NULL);
+        chain.insert(chain.end(), {scale, make_caps("I420", o.tile_w, o.tile_h), conv});
+    } else {
+        GstCaps* target = gst_caps_new_simple("video/x-raw",
+            "width", G_TYPE_INT, o.tile_w,
+            "height", G_TYPE_INT, o.tile_h,
+            NULL);
+        GstElement* stage = convert_chain_new(name, target, nullptr, threads);
+        gst_caps_unref(target);
+        if (!stage) return nullptr;
+        chain.push_back(stage);
+    }
+    chain.insert(chain.end(), {make_caps("BGRx"), sink});
+
+    for (GstElement* e : chain) gst_bin_add(GST_BIN(pipeline), e);
+    for (size_t i = 0; i + 1 < chain.size(); ++i) {
+        if (!gst_element_link(chain[i], chain[i + 1])) {
+            g_printerr("[%s] Failed to link the bench chain\n", name.c_str());
+            return nullptr;
+        }
+    }
+    return pipeline;
+}
+
+int main(int argc, char** argv) {
+    gst_init(&argc, &argv);
+
+    BenchOptions o;
+    if (!parse_args(argc, argv, o)) {
+        g_printerr("usage: %s [--streams N] [--frames F] [--size WxH] [--tile WxH] [--format I420|NV12] "
+                   "[--threads T] [--legacy]\n", argv[0]);
+        return 2;
+    }
+    const int threads = o.legacy ? 1 : (o.threads > 0 ? o.threads : convert_chain_threads((size_t)o.streams));
+
+    std::vector<GstElement*> pipes;
+    for (int i = 0; i < o.streams; ++i) {
+        GstElement* p = build(o, i, threads);
+        if (!p) return 1;
+        pipes.push_back(p);
+    }
+    // Negotiated and prerolled before the clock starts: only the per-frame work is measured
+    for (GstElement* p : pipes) gst_element_set_state(p, GST_STATE_PAUSED);
+    for (GstElement* p : pipes) gst_element_get_state(p, nullptr, nullptr, GST_CLOCK_TIME_NONE);
+
+    ProcSample before, after;
+    proc_sample(before);
+    for (GstElement* p : pipes) gst_element_set_state(p, GST_STATE_PLAYING);
+    bool ok = true;
+    for (GstElement* p : pipes) {
+        GstBus* bus = gst_element_get_bus(p);
+        GstMessage* msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE,
+                                                     (GstMessageType)(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+        if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) {
+            GError* err = nullptr;
+            gst_message_parse_error(msg, &err, nullptr);
+            g_printerr("[%s] %s\n", GST_OBJECT_NAME(p), err ? err->message : "error");
+            if (err) g_error_free(err);
+            ok = false;
+        }
+        gst_message_unref(msg);
+        gst_object_unref(bus);
+    }
+    proc_sample(after);
+    for (GstElement* p : pipes) {
+        gst_element_set_state(p, GST_STATE_NULL);
+        gst_object_unref(p);
+    }
+    if (!ok) return 1;
+
+    const double wall = after.wall_s - before.wall_s;
+    const double cpu = after.cpu_s - before.cpu_s;
+    const double total = (double)o.frames * o.streams;
+    std::printf("%s: %d streams, %s %dx%d -> BGRx %dx%d, %d threads per stream\n",
+                o.legacy ? "videoscale ! I420 ! videoconvert" : "convert_chain", o.streams, o.format.c_str(),
+                o.width, o.height, o.tile_w, o.tile_h, threads);
+    std::printf("  %.0f frames in %.2f s: %.1f fps per stream, CPU %.2f ms per frame (%.0f%% of one core)\n",
+                total, wall, o.frames / wall, cpu * 1000.0 / total, cpu * 100.0 / wall);
+    return 0;
+}
@@ -0,0 +1,167 @@
+// convert_chain.cpp
+#include "convert_chain.h"
+
+#include <gst/base/gstbasetransform.h>
+#include <gst/video/video.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "metrics.h"
+
+// Owned by the chain's bin; the probes run on its streaming thread
+struct ConvertChainState {
+    std::string name;
+    GstElement* capsf {nullptr};
+    std::vector<GstElement*> converters;
+    int threads {1};
+    bool two_pass {false};      // videoscale ! videoconvert (no videoconvertscale)
+    GstCaps* in_caps {nullptr};  // from the decoder, as last negotiated
+    std::string plan;           // logged last
+};
+
+static const char* kStateKey = "convert-chain";
+
+static void free_state(gpointer data) {
+    ConvertChainState* st = static_cast<ConvertChainState*>(data);
+    gst_caps_replace(&st->in_caps, nullptr);
+    delete st;
+}
+
+static std::string describe(const GstVideoInfo& v) {
+    return std::string(gst_video_format_to_string(GST_VIDEO_INFO_FORMAT(&v))) + " " +
+           std::to_string(GST_VIDEO_INFO_WIDTH(&v)) + "x" + std::to_string(GST_VIDEO_INFO_HEIGHT(&v));
+}
+
+// Chain input: remember the decoder's caps (the probe runs before the converter sees them)
+static GstPadProbeReturn on_input_caps(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+    GstEvent* ev = GST_PAD_PROBE_INFO_EVENT(info);
+    if (GST_EVENT_TYPE(ev) != GST_EVENT_CAPS) return GST_PAD_PROBE_OK;
+    GstCaps* caps = nullptr;
+    gst_event_parse_caps(ev, &caps);
+    gst_caps_replace(&static_cast<ConvertChainState*>(user_data)->in_caps, caps);
+    return GST_PAD_PROBE_OK;
+}
+
+// Chain output: the sink accepted these caps, log what that costs per frame when it changed
+static GstPadProbeReturn on_output_caps(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+    GstEvent* ev = GST_PAD_PROBE_INFO_EVENT(info);
+    if (GST_EVENT_TYPE(ev) != GST_EVENT_CAPS) return GST_PAD_PROBE_OK;
+    ConvertChainState* st = static_cast<ConvertChainState*>(user_data);
+    GstCaps* out_caps = nullptr;
+    gst_event_parse_caps(ev, &out_caps);
+    GstVideoInfo in, out;
+    if (!st->in_caps || !gst_video_info_from_caps(&in, st->in_caps) || !gst_video_info_from_caps(&out, out_caps)) {
+        return GST_PAD_PROBE_OK;
+    }
+    const bool convert = GST_VIDEO_INFO_FORMAT(&in) != GST_VIDEO_INFO_FORMAT(&out);
+    const bool scale = GST_VIDEO_INFO_WIDTH(&in) != GST_VIDEO_INFO_WIDTH(&out) ||
+                       GST_VIDEO_INFO_HEIGHT(&in) != GST_VIDEO_INFO_HEIGHT(&out);
+    std::string plan = describe(in) + " -> " + describe(out) + ": ";
+    if (convert && scale) plan += st->two_pass ? "scale, then convert" : "convert+scale in one pass";
+    else if (convert) plan += "convert";
+    else if (scale) plan += "scale";
+    else plan += "passthrough";
+    if ((convert || scale) && st->threads > 1) plan += ", " + std::to_string(st->threads) + " threads";
+    if (plan != st->plan) {
+        st->plan = plan;
+        g_print("[%s] Post-decode %s\n", st->name.c_str(), plan.c_str());
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+static void apply_threads(ConvertChainState* st, int threads) {
+    st->threads = std::max(1, threads);
+    for (GstElement* e : st->converters) {
+        if (g_object_class_find_property(G_OBJECT_GET_CLASS(e), "n-threads")) {
+            g_object_set(G_OBJECT(e), "n-threads", (guint)st->threads, NULL);
+        }
+    }
+}
+
+GstElement* convert_chain_new(const std::string& name, GstCaps* target, StreamMetrics* m, int threads) {
+    const bool sized = target && !gst_caps_is_any(target) && !gst_caps_is_empty(target) &&
+                       gst_structure_has_field(gst_caps_get_structure(target, 0), "width");
+    std::vector<GstElement*> stages;
+    GstElement* one = gst_element_factory_make("videoconvertscale", (name + "_convscale").c_str());
+    if (one) {
+        stages.push_back(one);
+    } else {
+        if (sized) stages.push_back(gst_element_factory_make("videoscale", (name + "_scale").c_str()));
+        stages.push_back(gst_element_factory_make("videoconvert", (name + "_conv").c_str()));
+    }
+    GstElement* capsf = gst_element_factory_make("capsfilter", (name + "_caps").c_str());
+    stages.push_back(capsf);
+    GstElement* bin = gst_bin_new((name + "_chain").c_str());
+    bool ok = true;
+    for (GstElement* e : stages) ok = ok && e;
+    if (!ok) {
+        for (GstElement* e : stages) {
+            if (e) gst_object_unref(e);
+        }
+        gst_object_unref(bin);
+        return nullptr;
+    }
+
+    ConvertChainState* st = new ConvertChainState();
+    st->name = name;
+    st->capsf = capsf;
+    st->two_pass = !one && sized;
+    g_object_set_data_full(G_OBJECT(bin), kStateKey, st, free_state);
+    if (target) g_object_set(G_OBJECT(capsf), "caps", target, NULL);
+
+    for (GstElement* e : stages) {
+        gst_bin_add(GST_BIN(bin), e);
+        if (e == capsf) continue;
+        st->converters.push_back(e);
+        convert_chain_count_copies(e, m);
+    }
+    apply_threads(st, threads);
+    for (size_t i = 0; i + 1 < stages.size(); ++i) gst_element_link(stages[i], stages[i + 1]);
+
+    GstPad* in = gst_element_get_static_pad(stages.front(), "sink");
+    GstPad* out = gst_element_get_static_pad(capsf, "src");
+    gst_pad_add_probe(in, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, on_input_caps, st, nullptr);
+    gst_pad_add_probe(out, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, on_output_caps, st, nullptr);
+    gst_element_add_pad(bin, gst_ghost_pad_new("sink", in));
+    gst_element_add_pad(bin, gst_ghost_pad_new("src", out));
+    gst_object_unref(in);
+    gst_object_unref(out);
+    return bin;
+}
+
+void convert_chain_set_target(GstElement* chain, GstCaps* target) {
+    ConvertChainState* st = static_cast<ConvertChainState*>(g_object_get_data(G_OBJECT(chain), kStateKey));
+    if (st) g_object_set(G_OBJECT(st->capsf), "caps", target, NULL);
+}
+
+void convert_chain_set_threads(GstElement* chain, int threads) {
+    ConvertChainState* st = static_cast<ConvertChainState*>(g_object_get_data(G_OBJECT(chain), kStateKey));
+    if (st) apply_threads(st, threads);
+}
+
+int convert_chain_threads(size_t streams) {
+    const char* env = std::getenv("GRID_CONVERT_THREADS");
+    const int v = (env && *env) ? std::atoi(env) : 0;
+    if (v > 0) return v;
+    const int cores = std::max(1, (int)std::thread::hardware_concurrency());
+    return std::max(1, cores / (int)std::max<size_t>(1, streams));
+}
+
+// Converter src pad: a frame the converter produced itself rather than passed through
+static GstPadProbeReturn on_converted(GstPad* pad, GstPadProbeInfo* /*info*/, gpointer user_data) {
+    GstObject* parent = GST_OBJECT_PARENT(pad);
+    if (parent && !gst_base_transform_is_passthrough(GST_BASE_TRANSFORM(parent))) {
+        static_cast<StreamMetrics*>(user_data)->convert_copies.fetch_add(1, std::memory_order_relaxed);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+void convert_chain_count_copies(GstElement* transform, StreamMetrics* m) {
+    if (!m) return;
+    GstPad* src = gst_element_get_static_pad(transform, "src");
+    gst_pad_add_probe(src, GST_PAD_PROBE_TYPE_BUFFER, on_converted, m, nullptr);
+    gst_object_unref(src);
+}
@@ -0,0 +1,42 @@
+// convert_chain.h
+// The raw-video stages between a decoder and its sink, planned from the caps on both sides instead
+// of a fixed videoconvert (! videoscale ! capsfilter) per builder.
+//
+// Target caps only constrain size and rate, never the format: the converter negotiates the format
+// of the sink closest to the decoder's, so a sink that takes the decoder's format leaves it in
+// passthrough (the frame is not touched), and any other sink gets exactly one conversion into a
+// format it takes natively. Converting and scaling happen in the same pass with videoconvertscale
+// (GStreamer 1.22+). Older versions get videoscale ! videoconvert, scaling first because tiles are
+// smaller than the camera frame, and no videoscale at all when the target has no size.
+//
+// The converters split every frame into stripes over `threads` threads (their n-threads pool, one
+// per converter), so a full-resolution main stream is not limited to one core; the line kernels are
+// GStreamer's ORC code (NEON on the Pi, SSE/AVX on x86).
+//
+// After negotiation the chain logs what it does per frame ("NV12 1920x1080 -> BGRx 640x360:
+// convert+scale"), again only when that changes. Every frame one of its converters produced itself
+// is counted in metrics frame_copies (convert stage).
+#pragma once
+
+#include <gst/gst.h>
+
+#include <string>
+
+struct StreamMetrics;
+
+// A bin with "sink" and "src" pads named `name`_chain, log prefix `name`. `target` may be null
+// (any size and rate the sink takes); ownership stays with the caller.
+GstElement* convert_chain_new(const std::string& name, GstCaps* target, StreamMetrics* m = nullptr,
+                              int threads = 1);
+
+// Changes the size/rate constraint, e.g. when the tile is resized (applies at the next renegotiation).
+void convert_chain_set_target(GstElement* chain, GstCaps* target);
+// Changes the converter threads (applies at the next renegotiation).
+void convert_chain_set_threads(GstElement* chain, int threads);
+
+// Threads per chain when `streams` chains convert at the same time: $GRID_CONVERT_THREADS, else the
+// cores shared out between them (at least 1, so a grid of sub streams keeps one thread each).
+int convert_chain_threads(size_t streams);
+
+// Counts every buffer `transform` (a GstBaseTransform) pushes while not in passthrough.
+void convert_chain_count_copies(GstElement* transform, StreamMetrics* m);
@@ -0,0 +1,397 @@
+// decoder_bench.cpp
+#include "decoder_bench.h"
+
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+#include "codec_chain.h"
+
+static const int kClipFrames = 60;             // 2 s at 30 fps, two GOPs
+static const gint64 kRunTimeoutUs = 20 * G_USEC_PER_SEC;
+
+struct BenchCodec {
+    const char* encoding;
+    const char* ext;
+    const char* stream_caps;   // what the parser must produce before filesink; null = as encoded
+    const char* encoders[5];   // "factory prop=value ...", first installed one is used
+};
+
+static const BenchCodec kBenchCodecs[] = {
+    { "H264", "h264", "video/x-h264,stream-format=byte-stream,alignment=au",
+      { "x264enc tune=zerolatency speed-preset=ultrafast key-int-max=30 bitrate=4000",
+        "openh264enc bitrate=4000000 gop-size=30",
+        "vah264enc bitrate=4000 key-int-max=30",
+        "v4l2h264enc", nullptr } },
+    { "H265", "h265", "video/x-h265,stream-format=byte-stream,alignment=au",
+      { "x265enc tune=zerolatency speed-preset=ultrafast key-int-max=30 bitrate=4000",
+        "vah265enc bitrate=4000 key-int-max=30",
+        "v4l2h265enc", nullptr, nullptr } },
+    { "JPEG", "mjpeg", nullptr,
+      { "jpegenc quality=85", nullptr, nullptr, nullptr, nullptr } },
+};
+
+struct BenchResult {
+    std::string decoder;
+    bool ok {false};
+    double fps {0.0};             // decoded frames per second after the first frame
+    double first_frame_ms {0.0};  // PLAYING -> first decoded frame
+    std::string error;
+};
+
+static std::mutex ranking_mutex;
+static std::map<std::string, std::vector<std::string>> rankings;
+
+static std::string cache_file(const std::string& leaf) {
+    gchar* path = g_build_filename(g_get_user_cache_dir(), "gstreamer-rtsp-grid", leaf.c_str(), NULL);
+    std::string s = path;
+    g_free(path);
+    return s;
+}
+
+static void clip_size(int& w, int& h) {
+    w = 1920;
+    h = 1080;
+    const char* env = std::getenv("GRID_DECODER_BENCH_SIZE");
+    int ew = 0, eh = 0;
+    if (env && std::sscanf(env, "%dx%d", &ew, &eh) == 2 && ew > 0 && eh > 0) {
+        w = ew;
+        h = eh;
+    }
+}
+
+static bool factory_installed(const std::string& name) {
+    GstElementFactory* f = gst_element_factory_find(name.c_str());
+    if (!f) return false;
+    gst_object_unref(f);
+    return true;
+}
+
+static std::string plugin_version(const std::string& factory) {
+    std::string v;
+    GstElementFactory* f = gst_element_factory_find(factory.c_str());
+    if (!f) return v;
+    GstPlugin* p = gst_plugin_feature_get_plugin(GST_PLUGIN_FEATURE(f));
+    if (p) {
+        const gchar* ver = gst_plugin_get_version(p);
+        if (ver) v = ver;
+        gst_object_unref(p);
+    }
+    gst_object_unref(f);
+    return v;
+}
+
+// Changes whenever GStreamer, the clip size or any candidate decoder (added, removed, updated)
+// changes; a cached ranking is only trusted while it matches.
+static std::string fingerprint(const std::vector<std::string>& decoders, int w, int h) {
+    gchar* ver = gst_version_string();
+    std::string s = std::string(ver) + " " + std::to_string(w) + "x" + std::to_string(h);
+    g_free(ver);
+    for (const std::string& d : decoders) s += " " + d + "=" + plugin_version(d);
+    gchar* sum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, s.c_str(), -1);
+    std::string fp(sum, 16);
+    g_free(sum);
+    return fp;
+}
+
+// "x264enc tune=zerolatency ..." -> element; properties this version does not have are skipped.
+static GstElement* make_encoder(const char* spec) {
+    gchar** parts = g_strsplit(spec, " ", -1);
+    GstElement* enc = gst_element_factory_make(parts[0], nullptr);
+    for (int i = 1; enc && parts[i]; ++i) {
+        gchar** kv = g_strsplit(parts[i], "=", 2);
+        if (kv[0] && kv[1] && g_object_class_find_property(G_OBJECT_GET_CLASS(enc), kv[0])) {
+            gst_util_set_object_arg(G_OBJECT(enc), kv[0], kv[1]);
+        }
+        g_strfreev(kv);
+    }
+    g_strfreev(parts);
+    return enc;
+}
+
+// PLAYING until EOS, ERROR or the timeout; leaves the pipeline in NULL.
+static bool run_pipeline(GstElement* pipeline, std::string* error) {
+    bool ok = false;
+    if (gst_element_set_state(pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        *error = "cannot start";
+    } else {
+        GstBus* bus = gst_element_get_bus(pipeline);
+        GstMessage* msg = gst_bus_timed_pop_filtered(bus, kRunTimeoutUs * GST_USECOND,
+                                                     (GstMessageType)(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+        if (!msg) {
+            *error = "timeout";
+        } else if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS) {
+            ok = true;
+        } else {
+            GError* err = nullptr; gchar* dbg = nullptr;
+            gst_message_parse_error(msg, &err, &dbg);
+            *error = err ? err->message : "error";
+            if (err) g_error_free(err); if (dbg) g_free(dbg);
+        }
+        if (msg) gst_message_unref(msg);
+        gst_object_unref(bus);
+    }
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    return ok;
+}
+
+// videotestsrc ! raw caps ! encoder [! parser ! stream caps] ! filesink. The SMPTE pattern scrolls
+// so P-frames carry real motion instead of repeating a still image.
+static bool encode_clip(const BenchCodec& bc, const char* encoder_spec, int w, int h, const std::string& path) {
+    GstElement* pipeline = gst_pipeline_new("bench-encode");
+    GstElement* src = gst_element_factory_make("videotestsrc", nullptr);
+    GstElement* rawcaps = gst_element_factory_make("capsfilter", nullptr);
+    GstElement* enc = make_encoder(encoder_spec);
+    GstElement* parse = bc.stream_caps ? gst_element_factory_make(codec_parser_name(bc.encoding), nullptr) : nullptr;
+    GstElement* streamcaps = bc.stream_caps ? gst_element_factory_make("capsfilter", nullptr) : nullptr;
+    GstElement* sink = gst_element_factory_make("filesink", nullptr);
+    if (!pipeline || !src || !rawcaps || !enc || !sink || (bc.stream_caps && (!parse || !streamcaps))) {
+        GstElement* elems[] = { src, rawcaps, enc, parse, streamcaps, sink };
+        for (GstElement* e : elems) if (e) gst_object_unref(e);
+        if (pipeline) gst_object_unref(pipeline);
+        return false;
+    }
+
+    g_object_set(G_OBJECT(src), "num-buffers", kClipFrames, "horizontal-speed", 4, NULL);
+    gst_util_set_object_arg(G_OBJECT(src), "pattern", "smpte");
+    GstCaps* caps = gst_caps_new_simple("video/x-raw",
+        "format", G_TYPE_STRING, "I420",
+        "width", G_TYPE_INT, w,
+        "height", G_TYPE_INT, h,
+        "framerate", GST_TYPE_FRACTION, 30, 1,
+        NULL);
+    g_object_set(G_OBJECT(rawcaps), "caps", caps, NULL);
+    gst_caps_unref(caps);
+    if (streamcaps) {
+        GstCaps* sc = gst_caps_from_string(bc.stream_caps);
+        g_object_set(G_OBJECT(streamcaps), "caps", sc, NULL);
+        gst_caps_unref(sc);
+    }
+    std::string part = path + ".part";
+    g_object_set(G_OBJECT(sink), "location", part.c_str(), NULL);
+
+    gst_bin_add_many(GST_BIN(pipeline), src, rawcaps, enc, sink, NULL);
+    bool linked;
+    if (parse) {
+        gst_bin_add_many(GST_BIN(pipeline), parse, streamcaps, NULL);
+        linked = gst_element_link_many(src, rawcaps, enc, parse, streamcaps, sink, NULL);
+    } else {
+        linked = gst_element_link_many(src, rawcaps, enc, sink, NULL);
+    }
+
+    std::string error = "cannot link";
+    bool ok = linked && run_pipeline(pipeline, &error);
+    gst_object_unref(pipeline);
+    if (ok) ok = g_rename(part.c_str(), path.c_str()) == 0;
+    if (!ok) {
+        g_printerr("[bench] %s: encoding the test clip failed (%s)\n", encoder_spec, error.c_str());
+        g_remove(part.c_str());
+    }
+    return ok;
+}
+
+// The clip is kept so a plugin update only re-runs the decoders, not the encoder.
+static bool ensure_clip(const BenchCodec& bc, int w, int h, std::string& path) {
+    path = cache_file("bench-" + std::to_string(w) + "x" + std::to_string(h) + "." + bc.ext);
+    if (g_file_test(path.c_str(), G_FILE_TEST_IS_REGULAR)) return true;
+
+    gchar* dir = g_path_get_dirname(path.c_str());
+    g_mkdir_with_parents(dir, 0755);
+    g_free(dir);
+    for (const char* spec : bc.encoders) {
+        if (!spec) break;
+        gchar* factory = g_strndup(spec, strcspn(spec, " "));
+        bool installed = factory_installed(factory);
+        g_free(factory);
+        if (installed && encode_clip(bc, spec, w, h, path)) return true;
+    }
+    return false;
+}
+
+struct FrameCount {
+    gint64 first_us {0};
+    gint64 last_us {0};
+    int frames {0};
+};
+
+static GstPadProbeReturn on_decoded(GstPad* /*pad*/, GstPadProbeInfo* /*info*/, gpointer user_data) {
+    FrameCount* fc = static_cast<FrameCount*>(user_data);
+    gint64 now = g_get_monotonic_time();
+    if (fc->frames++ == 0) fc->first_us = now;
+    fc->last_us = now;
+    return GST_PAD_PROBE_OK;
+}
+
+// filesrc ! parser ! decoder ! fakesink sync=false: as fast as the decoder goes.
+static BenchResult measure(const std::string& encoding, const std::string& decoder, const std::string& clip) {
+    BenchResult r;
+    r.decoder = decoder;
+
+    GstElement* pipeline = gst_pipeline_new("bench-decode");
+    GstElement* src = gst_element_factory_make("filesrc", nullptr);
+    GstElement* parse = gst_element_factory_make(codec_parser_name(encoding), nullptr);
+    GstElement* dec = gst_element_factory_make(decoder.c_str(), nullptr);
+    GstElement* sink = gst_element_factory_make("fakesink", nullptr);
+    if (!pipeline || !src || !parse || !dec || !sink) {
+        GstElement* elems[] = { src, parse, dec, sink };
+        for (GstElement* e : elems) if (e) gst_object_unref(e);
+        if (pipeline) gst_object_unref(pipeline);
+        r.error = "cannot create";
+        return r;
+    }
+    g_object_set(G_OBJECT(src), "location", clip.c_str(), NULL);
+    g_object_set(G_OBJECT(sink), "sync", FALSE, NULL);
+    gst_bin_add_many(GST_BIN(pipeline), src, parse, dec, sink, NULL);
+
+    FrameCount fc;
+    GstPad* pad = gst_element_get_static_pad(sink, "sink");
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, on_decoded, &fc, nullptr);
+    gst_object_unref(pad);
+
+    r.error = "cannot link";
+    gint64 start_us = g_get_monotonic_time();
+    bool ran = gst_element_link_many(src, parse, dec, sink, NULL) && run_pipeline(pipeline, &r.error);
+    gst_object_unref(pipeline);
+
+    if (ran && fc.frames < kClipFrames / 2) {
+        r.error = "decoded " + std::to_string(fc.frames) + " of " + std::to_string(kClipFrames) + " frames";
+    } else if (ran) {
+        r.ok = true;
+        r.error.clear();
+        r.first_frame_ms = (fc.first_us - start_us) / 1000.0;
+        double span_s = (fc.last_us - fc.first_us) / 1e6;
+        r.fps = span_s > 0 ? (fc.frames - 1) / span_s : 0.0;
+    }
+    return r;
+}
+
+// ---- Cached rankings: <user cache>/gstreamer-rtsp-grid/decoder-bench.ini ----
+
+static bool cache_load(GKeyFile* kf, const char* encoding, const std::string& fp, std::vector<std::string>& out) {
+    gchar* stored = g_key_file_get_string(kf, encoding, "fingerprint", nullptr);
+    bool match = stored && fp == stored;
+    g_free(stored);
+    if (!match) return false;
+    gsize n = 0;
+    gchar** list = g_key_file_get_string_list(kf, encoding, "ranking", &n, nullptr);
+    if (!list) return false;
+    out.assign(list, list + n);
+    g_strfreev(list);
+    return true;
+}
+
+static void cache_store(GKeyFile* kf, const char* encoding, const std::string& fp,
+                        const std::vector<BenchResult>& results) {
+    g_key_file_remove_group(kf, encoding, nullptr);
+    g_key_file_set_string(kf, encoding, "fingerprint", fp.c_str());
+    std::vector<const gchar*> ranking;
+    for (const BenchResult& r : results) {
+        if (r.ok) ranking.push_back(r.decoder.c_str());
+    }
+    g_key_file_set_string_list(kf, encoding, "ranking", ranking.data(), ranking.size());
+    // Informational only, the ranking above is what is used
+    for (const BenchResult& r : results) {
+        gchar* line = r.ok ? g_strdup_printf("%.1f fps, first frame %.0f ms", r.fps, r.first_frame_ms)
+                           : g_strdup_printf("failed: %s", r.error.c_str());
+        g_key_file_set_string(kf, encoding, r.decoder.c_str(), line);
+        g_free(line);
+    }
+}
+
+static std::string join(const std::vector<std::string>& v) {
+    std::string s;
+    for (const std::string& d : v) s += (s.empty() ? "" : ", ") + d;
+    return s;
+}
+
+void decoder_bench_calibrate() {
+    const char* env = std::getenv("GRID_DECODER_BENCH");
+    if (env && std::strcmp(env, "0") == 0) return;
+    const bool force = env && std::strcmp(env, "1") == 0;
+
+    int w = 0, h = 0;
+    clip_size(w, h);
+    const std::string ini = cache_file("decoder-bench.ini");
+    GKeyFile* kf = g_key_file_new();
+    g_key_file_load_from_file(kf, ini.c_str(), G_KEY_FILE_KEEP_COMMENTS, nullptr);
+    bool dirty = false;
+
+    for (const BenchCodec& bc : kBenchCodecs) {
+        // $GRID_DECODERS_<ENC> is an explicit choice, nothing to measure
+        std::string override_env = std::string("GRID_DECODERS_") + bc.encoding;
+        const char* ov = std::getenv(override_env.c_str());
+        if (ov && *ov) continue;
+        if (!factory_installed(codec_parser_name(bc.encoding))) continue;
+
+        std::vector<std::string> candidates;
+        for (const std::string& d : codec_builtin_decoders(bc.encoding)) {
+            if (factory_installed(d)) candidates.push_back(d);
+        }
+        if (candidates.size() < 2) continue;  // nothing to choose from
+
+        const std::string fp = fingerprint(candidates, w, h);
+        std::vector<std::string> ranking;
+        if (!force && cache_load(kf, bc.encoding, fp, ranking)) {
+            g_print("[bench] %s decoders (cached): %s\n", bc.encoding, join(ranking).c_str());
+        } else {
+            std::string clip;
+            if (!ensure_clip(bc, w, h, clip)) {
+                g_printerr("[bench] %s: no encoder for a test clip, keeping the built-in ranking\n", bc.encoding);
+                continue;
+            }
+            g_print("[bench] Calibrating %zu %s decoders at %dx%d...\n", candidates.size(), bc.encoding, w, h);
+            std::vector<BenchResult> results;
+            for (const std::string& d : candidates) {
+                BenchResult r = measure(bc.encoding, d, clip);
+                if (r.ok) {
+                    g_print("[bench] %s: %.1f fps, first frame %.0f ms\n", d.c_str(), r.fps, r.first_frame_ms);
+                } else {
+                    g_print("[bench] %s: failed (%s)\n", d.c_str(), r.error.c_str());
+                }
+                results.push_back(r);
+            }
+            std::stable_sort(results.begin(), results.end(), [](const BenchResult& a, const BenchResult& b) {
+                if (a.ok != b.ok) return a.ok;
+                if (a.fps != b.fps) return a.fps > b.fps;
+                return a.first_frame_ms < b.first_frame_ms;
+            });
+            for (const BenchResult& r : results) {
+                if (r.ok) ranking.push_back(r.decoder);
+            }
+            cache_store(kf, bc.encoding, fp, results);
+            dirty = true;
+            // Decoders remembered per camera were picked under the old ranking
+            codec_chain_forget_choices(bc.encoding);
+            g_print("[bench] %s decoders: %s\n", bc.encoding, join(ranking).c_str());
+        }
+        if (ranking.empty()) continue;
+        std::lock_guard<std::mutex> lock(ranking_mutex);
+        rankings[bc.encoding] = ranking;
+    }
+
+    if (dirty) {
+        GError* err = nullptr;
+        if (!g_key_file_save_to_file(kf, ini.c_str(), &err)) {
+            g_printerr("Cannot write %s: %s\n", ini.c_str(), err ? err->message : "");
+        }
+        if (err) g_error_free(err);
+    }
+    g_key_file_free(kf);
+}
+
+bool decoder_bench_ranking(const std::string& encoding, std::vector<std::string>& out) {
+    std::lock_guard<std::mutex> lock(ranking_mutex);
+    for (const auto& kv : rankings) {
+        if (g_ascii_strcasecmp(kv.first.c_str(), encoding.c_str()) == 0) {
+            out = kv.second;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,23 @@
+// decoder_bench.h
+// Startup calibration of the installed decoders.
+//
+// For every codec with more than one installed decoder, a short clip is encoded once with
+// whatever encoder is installed (x264enc, x265enc, jpegenc, ...), kept in the user cache directory,
+// and decoded by each candidate as fast as possible. Decoders are ranked by frames/s, first-frame
+// latency breaking ties. The ranking is stored next to the clip and reused until GStreamer or one
+// of the candidate plugins changes, so only the first launch on a box pays for the calibration.
+//
+// $GRID_DECODER_BENCH=0 disables it (built-in ranking), =1 forces a new run.
+// $GRID_DECODER_BENCH_SIZE=WxH sets the clip size (default 1920x1080, a typical main stream).
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Loads the cached ranking or runs the calibration. Call once after gst_init(), before any
+// pipeline is built (it blocks: a few seconds per decoder on the first launch only).
+void decoder_bench_calibrate();
+
+// Measured ranking for an encoding-name, fastest first; decoders that failed on the clip are not
+// in it. False when the codec was not calibrated.
+bool decoder_bench_ranking(const std::string& encoding, std::vector<std::string>& out);
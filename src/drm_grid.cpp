@@ -0,0 +1,860 @@
+// drm_grid.cpp
+#include "drm_grid.h"
+
+#include <gst/allocators/gstdmabuf.h>
+#include <gst/video/video.h>
+
+#include <drm_fourcc.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <xf86drm.h>
+#include <xf86drmMode.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include "metrics.h"
+
+// Frames the display may hold per tile besides the one upstream is filling: mailbox, on screen,
+// committed waiting for the flip
+static const guint kHeldFrames = 3;
+// Imported framebuffers kept per tile; more than any decoder pool, fewer than a renegotiation leak
+static const size_t kMaxImports = 24;
+
+// ---- Formats ----
+
+struct FormatMap {
+    GstVideoFormat gst;
+    uint32_t drm;
+};
+
+// In order of preference when the converter has to pick one
+static const FormatMap kFormats[] = {
+    {GST_VIDEO_FORMAT_BGRx, DRM_FORMAT_XRGB8888},
+    {GST_VIDEO_FORMAT_BGRA, DRM_FORMAT_ARGB8888},
+    {GST_VIDEO_FORMAT_RGBx, DRM_FORMAT_XBGR8888},
+    {GST_VIDEO_FORMAT_RGBA, DRM_FORMAT_ABGR8888},
+    {GST_VIDEO_FORMAT_NV12, DRM_FORMAT_NV12},
+    {GST_VIDEO_FORMAT_NV21, DRM_FORMAT_NV21},
+    {GST_VIDEO_FORMAT_I420, DRM_FORMAT_YUV420},
+    {GST_VIDEO_FORMAT_YUY2, DRM_FORMAT_YUYV},
+    {GST_VIDEO_FORMAT_UYVY, DRM_FORMAT_UYVY},
+};
+
+static uint32_t drm_format(GstVideoFormat f) {
+    for (const FormatMap& m : kFormats) {
+        if (m.gst == f) return m.drm;
+    }
+    return 0;
+}
+
+// ---- Properties ----
+
+// Finds property `name` of a KMS object; its current value in `value` (optional).
+static uint32_t prop_id(int fd, uint32_t obj, uint32_t type, const char* name, uint64_t* value = nullptr) {
+    drmModeObjectProperties* props = drmModeObjectGetProperties(fd, obj, type);
+    uint32_t id = 0;
+    for (uint32_t i = 0; props && i < props->count_props && !id; ++i) {
+        drmModePropertyRes* p = drmModeGetProperty(fd, props->props[i]);
+        if (p && std::strcmp(p->name, name) == 0) {
+            id = p->prop_id;
+            if (value) *value = props->prop_values[i];
+        }
+        drmModeFreeProperty(p);
+    }
+    drmModeFreeObjectProperties(props);
+    return id;
+}
+
+static void add_prop(int fd, drmModeAtomicReq* req, uint32_t obj, uint32_t type, const char* name, uint64_t value) {
+    if (uint32_t id = prop_id(fd, obj, type, name)) drmModeAtomicAddProperty(req, obj, id, value);
+}
+
+// Source (whole framebuffer, 16.16 fixed point) and destination rectangle of a plane.
+static void add_plane(int fd, drmModeAtomicReq* req, uint32_t plane, uint32_t crtc, uint32_t fb_id, int src_w,
+                      int src_h, const TileRect& dst) {
+    const uint32_t t = DRM_MODE_OBJECT_PLANE;
+    add_prop(fd, req, plane, t, "FB_ID", fb_id);
+    add_prop(fd, req, plane, t, "CRTC_ID", crtc);
+    add_prop(fd, req, plane, t, "SRC_X", 0);
+    add_prop(fd, req, plane, t, "SRC_Y", 0);
+    add_prop(fd, req, plane, t, "SRC_W", (uint64_t)src_w << 16);
+    add_prop(fd, req, plane, t, "SRC_H", (uint64_t)src_h << 16);
+    add_prop(fd, req, plane, t, "CRTC_X", (uint64_t)dst.x);
+    add_prop(fd, req, plane, t, "CRTC_Y", (uint64_t)dst.y);
+    add_prop(fd, req, plane, t, "CRTC_W", (uint64_t)dst.w);
+    add_prop(fd, req, plane, t, "CRTC_H", (uint64_t)dst.h);
+}
+
+// ---- Dumb buffers ----
+
+static void destroy_buffer(int fd, DrmBuffer* b) {
+    if (b->map) munmap(b->map, b->size);
+    if (b->fb_id) drmModeRmFB(fd, b->fb_id);
+    if (b->handle) {
+        drm_mode_destroy_dumb d {};
+        d.handle = b->handle;
+        drmIoctl(fd, DRM_IOCTL_MODE_DESTROY_DUMB, &d);
+    }
+    *b = DrmBuffer {};
+}
+
+// XRGB8888 (the bytes of GStreamer's BGRx), cleared to black.
+static bool create_buffer(int fd, int width, int height, DrmBuffer* b) {
+    drm_mode_create_dumb creq {};
+    creq.width = (uint32_t)width;
+    creq.height = (uint32_t)height;
+    creq.bpp = 32;
+    if (drmIoctl(fd, DRM_IOCTL_MODE_CREATE_DUMB, &creq)) return false;
+    b->handle = creq.handle;
+    b->pitch = creq.pitch;
+    b->size = creq.size;
+    b->width = width;
+    b->height = height;
+    uint32_t handles[4] = {b->handle}, pitches[4] = {b->pitch}, offsets[4] = {0};
+    if (drmModeAddFB2(fd, (uint32_t)width, (uint32_t)height, DRM_FORMAT_XRGB8888, handles, pitches, offsets,
+                      &b->fb_id, 0)) {
+        destroy_buffer(fd, b);
+        return false;
+    }
+    drm_mode_map_dumb mreq {};
+    mreq.handle = b->handle;
+    void* map = MAP_FAILED;
+    if (!drmIoctl(fd, DRM_IOCTL_MODE_MAP_DUMB, &mreq)) {
+        map = mmap(nullptr, b->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, (off_t)mreq.offset);
+    }
+    if (map == MAP_FAILED) {
+        destroy_buffer(fd, b);
+        return false;
+    }
+    b->map = static_cast<uint8_t*>(map);
+    std::memset(b->map, 0, b->size);
+    return true;
+}
+
+// Copies the BGRx frame into `dst` at (x, y), clipped to w x h. False if the frame is not BGRx.
+static bool blit(GstSample* sample, DrmBuffer& dst, int x, int y, int w, int h) {
+    GstVideoInfo info;
+    GstCaps* caps = gst_sample_get_caps(sample);
+    GstBuffer* buf = gst_sample_get_buffer(sample);
+    if (!caps || !buf || !gst_video_info_from_caps(&info, caps)) return false;
+    if (GST_VIDEO_INFO_FORMAT(&info) != GST_VIDEO_FORMAT_BGRx && GST_VIDEO_INFO_FORMAT(&info) != GST_VIDEO_FORMAT_BGRA) {
+        return false;
+    }
+    GstVideoFrame frame;
+    if (!gst_video_frame_map(&frame, &info, buf, GST_MAP_READ)) return false;
+    const uint8_t* src = static_cast<const uint8_t*>(GST_VIDEO_FRAME_PLANE_DATA(&frame, 0));
+    const int stride = GST_VIDEO_FRAME_PLANE_STRIDE(&frame, 0);
+    const int cw = std::min(w, GST_VIDEO_FRAME_WIDTH(&frame));
+    const int ch = std::min(h, GST_VIDEO_FRAME_HEIGHT(&frame));
+    for (int row = 0; row < ch; ++row) {
+        std::memcpy(dst.map + (size_t)(y + row) * dst.pitch + (size_t)x * 4, src + (size_t)row * stride,
+                    (size_t)cw * 4);
+    }
+    gst_video_frame_unmap(&frame);
+    return true;
+}
+
+// ---- Scanout buffer pool ----
+//
+// Proposed to the tile pipelines: frames are written by upstream (videoconvert, videoscale, a
+// software decoder) straight into dumb buffers, exported as dmabufs, that the grid can scan out.
+
+struct DrmDumbPool {
+    GstBufferPool parent;
+    int fd;
+    GstAllocator* allocator;
+    GstVideoInfo info;
+};
+
+struct DrmDumbPoolClass {
+    GstBufferPoolClass parent_class;
+};
+
+G_DEFINE_TYPE(DrmDumbPool, drm_dumb_pool, GST_TYPE_BUFFER_POOL)
+
+static gboolean drm_dumb_pool_set_config(GstBufferPool* pool, GstStructure* config) {
+    DrmDumbPool* self = reinterpret_cast<DrmDumbPool*>(pool);
+    GstCaps* caps = nullptr;
+    guint size = 0, min = 0, max = 0;
+    if (!gst_buffer_pool_config_get_params(config, &caps, &size, &min, &max) || !caps) return FALSE;
+    if (!gst_video_info_from_caps(&self->info, caps)) return FALSE;
+    // Packed formats and NV12: one dumb buffer each, planes at the driver's pitch
+    const GstVideoFormat f = GST_VIDEO_INFO_FORMAT(&self->info);
+    if (!drm_format(f) || (GST_VIDEO_INFO_N_PLANES(&self->info) > 1 && f != GST_VIDEO_FORMAT_NV12)) return FALSE;
+    return GST_BUFFER_POOL_CLASS(drm_dumb_pool_parent_class)->set_config(pool, config);
+}
+
+static GstFlowReturn drm_dumb_pool_alloc(GstBufferPool* pool, GstBuffer** out, GstBufferPoolAcquireParams* /*params*/) {
+    DrmDumbPool* self = reinterpret_cast<DrmDumbPool*>(pool);
+    const GstVideoInfo& info = self->info;
+    const bool nv12 = GST_VIDEO_INFO_FORMAT(&info) == GST_VIDEO_FORMAT_NV12;
+    const int height = GST_VIDEO_INFO_HEIGHT(&info);
+    drm_mode_create_dumb creq {};
+    creq.width = (uint32_t)GST_VIDEO_INFO_WIDTH(&info);
+    creq.height = (uint32_t)(nv12 ? height + (height + 1) / 2 : height);
+    creq.bpp = (uint32_t)GST_VIDEO_INFO_COMP_PSTRIDE(&info, 0) * 8;  // NV12: 8-bit rows, chroma below luma
+    if (drmIoctl(self->fd, DRM_IOCTL_MODE_CREATE_DUMB, &creq)) return GST_FLOW_ERROR;
+    int prime = -1;
+    const int ret = drmPrimeHandleToFD(self->fd, creq.handle, DRM_CLOEXEC | DRM_RDWR, &prime);
+    // The dmabuf keeps the buffer alive; the grid imports it again by fd
+    drm_mode_destroy_dumb d {};
+    d.handle = creq.handle;
+    drmIoctl(self->fd, DRM_IOCTL_MODE_DESTROY_DUMB, &d);
+    if (ret) return GST_FLOW_ERROR;
+
+    GstBuffer* buf = gst_buffer_new();
+    gst_buffer_append_memory(buf, gst_dmabuf_allocator_alloc(self->allocator, prime, creq.size));
+    gsize offsets[GST_VIDEO_MAX_PLANES] = {0, nv12 ? (gsize)creq.pitch * height : 0};
+    gint strides[GST_VIDEO_MAX_PLANES] = {(gint)creq.pitch, (gint)creq.pitch};
+    gst_buffer_add_video_meta_full(buf, GST_VIDEO_FRAME_FLAG_NONE, GST_VIDEO_INFO_FORMAT(&info),
+                                   GST_VIDEO_INFO_WIDTH(&info), height, GST_VIDEO_INFO_N_PLANES(&info), offsets,
+                                   strides);
+    *out = buf;
+    return GST_FLOW_OK;
+}
+
+static void drm_dumb_pool_finalize(GObject* object) {
+    DrmDumbPool* self = reinterpret_cast<DrmDumbPool*>(object);
+    if (self->allocator) gst_object_unref(self->allocator);
+    G_OBJECT_CLASS(drm_dumb_pool_parent_class)->finalize(object);
+}
+
+static void drm_dumb_pool_class_init(DrmDumbPoolClass* klass) {
+    G_OBJECT_CLASS(klass)->finalize = drm_dumb_pool_finalize;
+    GST_BUFFER_POOL_CLASS(klass)->set_config = drm_dumb_pool_set_config;
+    GST_BUFFER_POOL_CLASS(klass)->alloc_buffer = drm_dumb_pool_alloc;
+}
+
+static void drm_dumb_pool_init(DrmDumbPool* self) {
+    self->fd = -1;
+    self->allocator = gst_dmabuf_allocator_new();
+    gst_video_info_init(&self->info);
+}
+
+// Sink pad ALLOCATION query: the dumb-buffer pool for system-memory caps of the tile's path,
+// and how many frames the display holds on to (decoders size their own pools with it)
+static GstPadProbeReturn on_allocation_query(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+    GstQuery* q = GST_PAD_PROBE_INFO_QUERY(info);
+    if (GST_QUERY_TYPE(q) != GST_QUERY_ALLOCATION) return GST_PAD_PROBE_OK;
+    DrmTile* t = static_cast<DrmTile*>(user_data);
+    GstCaps* caps = nullptr;
+    gboolean need_pool = FALSE;
+    gst_query_parse_allocation(q, &caps, &need_pool);
+    GstVideoInfo vi;
+    if (!caps || !gst_video_info_from_caps(&vi, caps)) return GST_PAD_PROBE_OK;
+
+    GstCapsFeatures* features = gst_caps_get_features(caps, 0);
+    const bool dmabuf_caps = features && gst_caps_features_contains(features, GST_CAPS_FEATURE_MEMORY_DMABUF);
+    GstBufferPool* pool = nullptr;
+    if (t->path.load() != TilePath::Copy && !dmabuf_caps && drm_format(GST_VIDEO_INFO_FORMAT(&vi))) {
+        DrmDumbPool* dumb = static_cast<DrmDumbPool*>(g_object_new(drm_dumb_pool_get_type(), nullptr));
+        gst_object_ref_sink(dumb);
+        dumb->fd = t->grid->fd;
+        pool = GST_BUFFER_POOL(dumb);
+        GstStructure* config = gst_buffer_pool_get_config(pool);
+        gst_buffer_pool_config_set_params(config, caps, (guint)GST_VIDEO_INFO_SIZE(&vi), kHeldFrames + 1, 0);
+        gst_buffer_pool_config_add_option(config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+        if (!gst_buffer_pool_set_config(pool, config)) {
+            gst_object_unref(pool);
+            pool = nullptr;
+        }
+    }
+    gst_query_add_allocation_pool(q, pool, (guint)GST_VIDEO_INFO_SIZE(&vi), kHeldFrames, 0);
+    gst_query_add_allocation_meta(q, GST_VIDEO_META_API_TYPE, nullptr);
+    if (pool) gst_object_unref(pool);
+    return GST_PAD_PROBE_OK;
+}
+
+// ---- Import ----
+
+// Plane layout of a frame whose every plane lives in a dmabuf. False for system memory, unknown
+// formats or frames without the layout the caps promise.
+static bool frame_layout(GstSample* sample, DrmImport& im, int fds[4]) {
+    GstCaps* caps = gst_sample_get_caps(sample);
+    GstBuffer* buf = gst_sample_get_buffer(sample);
+    if (!caps || !buf) return false;
+    GstVideoInfo info;
+    im = DrmImport {};
+    im.modifier = DRM_FORMAT_MOD_INVALID;  // implicit: whatever the driver agreed with the exporter
+#if GST_CHECK_VERSION(1, 24, 0)
+    if (gst_video_is_dma_drm_caps(caps)) {
+        GstVideoInfoDmaDrm drm;
+        if (!gst_video_info_dma_drm_from_caps(&drm, caps)) return false;
+        im.fourcc = drm.drm_fourcc;
+        im.modifier = drm.drm_modifier;
+        info = drm.vinfo;
+    } else
+#endif
+    {
+        if (!gst_video_info_from_caps(&info, caps)) return false;
+        im.fourcc = drm_format(GST_VIDEO_INFO_FORMAT(&info));
+    }
+    if (!im.fourcc) return false;
+    im.width = GST_VIDEO_INFO_WIDTH(&info);
+    im.height = GST_VIDEO_INFO_HEIGHT(&info);
+
+    GstVideoMeta* meta = gst_buffer_get_video_meta(buf);
+    const guint n_planes = meta ? meta->n_planes : GST_VIDEO_INFO_N_PLANES(&info);
+    if (n_planes == 0 || n_planes > 4) return false;
+    for (guint p = 0; p < n_planes; ++p) {
+        const gsize offset = meta ? meta->offset[p] : GST_VIDEO_INFO_PLANE_OFFSET(&info, p);
+        guint idx = 0, len = 0;
+        gsize skip = 0;
+        if (!gst_buffer_find_memory(buf, offset, 1, &idx, &len, &skip)) return false;
+        GstMemory* mem = gst_buffer_peek_memory(buf, idx);
+        if (!gst_is_dmabuf_memory(mem)) return false;
+        fds[p] = gst_dmabuf_memory_get_fd(mem);
+        im.offsets[p] = (uint32_t)(mem->offset + skip);
+        im.pitches[p] = (uint32_t)(meta ? meta->stride[p] : GST_VIDEO_INFO_PLANE_STRIDE(&info, p));
+    }
+    return true;
+}
+
+static bool same_layout(const DrmImport& a, const DrmImport& b) {
+    return std::memcmp(a.handles, b.handles, sizeof(a.handles)) == 0 &&
+           std::memcmp(a.pitches, b.pitches, sizeof(a.pitches)) == 0 &&
+           std::memcmp(a.offsets, b.offsets, sizeof(a.offsets)) == 0 && a.fourcc == b.fourcc &&
+           a.modifier == b.modifier && a.width == b.width && a.height == b.height;
+}
+
+static void close_handle(int fd, uint32_t handle) {
+    drm_gem_close c {};
+    c.handle = handle;
+    drmIoctl(fd, DRM_IOCTL_GEM_CLOSE, &c);
+}
+
+// Removes the framebuffers for which `drop` is true, and the handles no remaining one uses.
+template <typename Pred>
+static void drop_imports(int fd, DrmTile& t, Pred drop) {
+    std::vector<uint32_t> handles;
+    auto keep = std::stable_partition(t.imports.begin(), t.imports.end(), [&](const DrmImport& im) { return !drop(im); });
+    for (auto it = keep; it != t.imports.end(); ++it) {
+        drmModeRmFB(fd, it->fb_id);
+        handles.insert(handles.end(), std::begin(it->handles), std::end(it->handles));
+    }
+    t.imports.erase(keep, t.imports.end());
+    std::sort(handles.begin(), handles.end());
+    handles.erase(std::unique(handles.begin(), handles.end()), handles.end());
+    for (uint32_t h : handles) {
+        const bool used = h == 0 || std::any_of(t.imports.begin(), t.imports.end(), [h](const DrmImport& im) {
+            return std::find(std::begin(im.handles), std::end(im.handles), h) != std::end(im.handles);
+        });
+        if (!used) close_handle(fd, h);
+    }
+}
+
+// The framebuffer for a dmabuf frame, imported on first sight. 0 if the frame is not a dmabuf
+// or the driver cannot scan it out.
+static const DrmImport* import_frame(DrmGrid* g, DrmTile& t, GstSample* sample) {
+    DrmImport im;
+    int fds[4] = {-1, -1, -1, -1};
+    if (!frame_layout(sample, im, fds)) return nullptr;
+    for (int p = 0; p < 4 && fds[p] >= 0; ++p) {
+        // The same dmabuf always gives the same handle, so the handles identify the buffer
+        if (drmPrimeFDToHandle(g->fd, fds[p], &im.handles[p])) return nullptr;
+    }
+    for (const DrmImport& known : t.imports) {
+        if (same_layout(known, im)) return &known;
+    }
+    if (t.imports.size() >= kMaxImports) {
+        drop_imports(g->fd, t, [&t](const DrmImport& old) { return old.fb_id != t.shown_fb && old.fb_id != t.pending_fb; });
+    }
+    int ret;
+    if (im.modifier != DRM_FORMAT_MOD_INVALID) {
+        uint64_t modifiers[4] = {};
+        for (int p = 0; p < 4 && im.handles[p]; ++p) modifiers[p] = im.modifier;
+        ret = drmModeAddFB2WithModifiers(g->fd, (uint32_t)im.width, (uint32_t)im.height, im.fourcc, im.handles,
+                                         im.pitches, im.offsets, modifiers, &im.fb_id, DRM_MODE_FB_MODIFIERS);
+    } else {
+        ret = drmModeAddFB2(g->fd, (uint32_t)im.width, (uint32_t)im.height, im.fourcc, im.handles, im.pitches,
+                            im.offsets, &im.fb_id, 0);
+    }
+    t.imports.push_back(im);
+    if (ret) {
+        t.imports.back().fb_id = 0;
+        drop_imports(g->fd, t, [](const DrmImport& failed) { return failed.fb_id == 0; });
+        return nullptr;
+    }
+    return &t.imports.back();
+}
+
+// A new format, size or modifier on the plane: does the driver take it (scaling, pitch, tiling)?
+static bool plane_accepts(DrmGrid* g, DrmTile& t, const DrmImport& im) {
+    if (im.fourcc == t.tested.fourcc && im.modifier == t.tested.modifier && im.width == t.tested.width &&
+        im.height == t.tested.height && im.pitches[0] == t.tested.pitches[0]) {
+        return true;
+    }
+    drmModeAtomicReq* req = drmModeAtomicAlloc();
+    add_plane(g->fd, req, t.plane_id, g->crtc_id, im.fb_id, im.width, im.height, t.rect);
+    const int ret = drmModeAtomicCommit(g->fd, req, DRM_MODE_ATOMIC_TEST_ONLY, nullptr);
+    drmModeAtomicFree(req);
+    if (ret == 0) t.tested = im;
+    return ret == 0;
+}
+
+// ---- Tile caps ----
+
+static GstCaps* tile_caps(const DrmTile& t) {
+    if (t.path.load() != TilePath::Import) {
+        return gst_caps_new_simple("video/x-raw",
+            "format", G_TYPE_STRING, "BGRx",
+            "width", G_TYPE_INT, t.rect.w,
+            "height", G_TYPE_INT, t.rect.h,
+            NULL);
+    }
+    // What the plane scans out, at any size: memory:DMABuf first (hardware decoders), then the
+    // same formats in system memory (written into the dumb-buffer pool, or copied after all)
+    GValue formats = G_VALUE_INIT;
+    g_value_init(&formats, GST_TYPE_LIST);
+    for (const FormatMap& m : kFormats) {
+        if (std::find(t.plane_formats.begin(), t.plane_formats.end(), m.drm) == t.plane_formats.end()) continue;
+        GValue v = G_VALUE_INIT;
+        g_value_init(&v, G_TYPE_STRING);
+        g_value_set_string(&v, gst_video_format_to_string(m.gst));
+        gst_value_list_append_and_take_value(&formats, &v);
+    }
+    GstCaps* caps = gst_caps_new_empty();
+    GstStructure* dmabuf = gst_structure_new_empty("video/x-raw");
+    gst_structure_set_value(dmabuf, "format", &formats);
+    GstStructure* sysmem = gst_structure_copy(dmabuf);
+    gst_caps_append_structure_full(caps, dmabuf, gst_caps_features_new(GST_CAPS_FEATURE_MEMORY_DMABUF, NULL));
+#if GST_CHECK_VERSION(1, 24, 0)
+    gst_caps_append_structure_full(caps, gst_structure_new("video/x-raw", "format", G_TYPE_STRING, "DMA_DRM", NULL),
+                                   gst_caps_features_new(GST_CAPS_FEATURE_MEMORY_DMABUF, NULL));
+#endif
+    gst_caps_append_structure(caps, sysmem);
+    g_value_unset(&formats);
+    return caps;
+}
+
+// Import failed: one step down the path, renegotiating the tile's current pipeline if the caps
+// change. The frame that failed is copied if it can be, or skipped.
+static void step_down(DrmTile& t, const char* why) {
+    const TilePath from = t.path.load();
+    const TilePath to = from == TilePath::Import ? TilePath::ImportTile : TilePath::Copy;
+    t.path = to;
+    g_print("[%s] Zero-copy %s (%s)\n", t.mailbox->name.c_str(),
+            to == TilePath::Copy ? "off, copying to the plane" : "at tile size: BGRx from the scanout pool", why);
+    if (from != TilePath::Import) return;  // same caps
+    GstElement* sink = static_cast<GstElement*>(g_weak_ref_get(&t.sink));
+    if (!sink) return;
+    GstCaps* caps = tile_caps(t);
+    g_object_set(G_OBJECT(sink), "caps", caps, NULL);
+    gst_caps_unref(caps);
+    GstPad* pad = gst_element_get_static_pad(sink, "sink");
+    gst_pad_push_event(pad, gst_event_new_reconfigure());
+    gst_object_unref(pad);
+    gst_object_unref(sink);
+}
+
+// ---- Device ----
+
+static bool pick_output(DrmGrid* g, int fd) {
+    drmModeRes* res = drmModeGetResources(fd);
+    if (!res) return false;
+    bool ok = false;
+    for (int i = 0; i < res->count_connectors && !ok; ++i) {
+        drmModeConnector* c = drmModeGetConnector(fd, res->connectors[i]);
+        if (!c) continue;
+        if (c->connection == DRM_MODE_CONNECTED && c->count_modes > 0) {
+            drmModeModeInfo mode = c->modes[0];
+            for (int m = 0; m < c->count_modes; ++m) {
+                if (c->modes[m].type & DRM_MODE_TYPE_PREFERRED) {
+                    mode = c->modes[m];
+                    break;
+                }
+            }
+            for (int e = 0; e < c->count_encoders && !ok; ++e) {
+                drmModeEncoder* enc = drmModeGetEncoder(fd, c->encoders[e]);
+                if (!enc) continue;
+                for (int k = 0; k < res->count_crtcs && !ok; ++k) {
+                    if (!(enc->possible_crtcs & (1u << k))) continue;
+                    g->crtc_id = res->crtcs[k];
+                    g->crtc_index = k;
+                    ok = true;
+                }
+                drmModeFreeEncoder(enc);
+            }
+            if (ok && drmModeCreatePropertyBlob(fd, &mode, sizeof(mode), &g->mode_blob) == 0) {
+                g->connector_id = c->connector_id;
+                g->width = mode.hdisplay;
+                g->height = mode.vdisplay;
+                g->refresh_hz = (int)mode.vrefresh;
+            } else {
+                ok = false;
+            }
+        }
+        drmModeFreeConnector(c);
+    }
+    drmModeFreeResources(res);
+    return ok;
+}
+
+static bool try_device(DrmGrid* g, const std::string& path) {
+    int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) return false;
+    uint64_t dumb = 0;
+    if (drmGetCap(fd, DRM_CAP_DUMB_BUFFER, &dumb) || !dumb ||
+        drmSetClientCap(fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1) || drmSetClientCap(fd, DRM_CLIENT_CAP_ATOMIC, 1) ||
+        !pick_output(g, fd)) {
+        close(fd);
+        return false;
+    }
+    g->fd = fd;
+    g->device = path;
+    return true;
+}
+
+bool drm_grid_open(DrmGrid* g) {
+    const char* env = std::getenv("GRID_DRM_DEVICE");
+    bool ok = false;
+    if (env && *env) {
+        ok = try_device(g, env);
+    } else {
+        for (int i = 0; i < 8 && !ok; ++i) ok = try_device(g, "/dev/dri/card" + std::to_string(i));
+    }
+    if (!ok) {
+        g_printerr("[drm] No card with a connected display and atomic modesetting%s%s\n", env ? " at " : "",
+                   env ? env : "");
+        return false;
+    }
+    g_print("[drm] %s: %dx%d@%d\n", g->device.c_str(), g->width, g->height, g->refresh_hz);
+    return true;
+}
+
+DrmTile::~DrmTile() {
+    g_weak_ref_clear(&sink);
+    if (shown_sample) gst_sample_unref(shown_sample);
+    if (pending_sample) gst_sample_unref(pending_sample);
+}
+
+void drm_grid_add_tile(DrmGrid* g, FrameMailbox* mb, const TileRect& rect, StreamMetrics* m) {
+    auto t = std::make_unique<DrmTile>();
+    t->grid = g;
+    t->mailbox = mb;
+    t->metrics = m;
+    t->rect = rect;
+    g_weak_ref_init(&t->sink, nullptr);
+    g->tiles.push_back(std::move(t));
+}
+
+// Overlay planes of our CRTC that take XRGB8888, with every format they take
+static void find_planes(DrmGrid* g, std::vector<std::vector<uint32_t>>& overlay_formats) {
+    drmModePlaneRes* res = drmModeGetPlaneResources(g->fd);
+    for (uint32_t i = 0; res && i < res->count_planes; ++i) {
+        drmModePlane* p = drmModeGetPlane(g->fd, res->planes[i]);
+        if (!p) continue;
+        std::vector<uint32_t> formats(p->formats, p->formats + p->count_formats);
+        uint64_t type = 0;
+        if ((p->possible_crtcs & (1u << g->crtc_index)) &&
+            std::find(formats.begin(), formats.end(), DRM_FORMAT_XRGB8888) != formats.end() &&
+            prop_id(g->fd, p->plane_id, DRM_MODE_OBJECT_PLANE, "type", &type)) {
+            if (type == DRM_PLANE_TYPE_PRIMARY && !g->primary_plane) g->primary_plane = p->plane_id;
+            if (type == DRM_PLANE_TYPE_OVERLAY) {
+                g->overlays.push_back(p->plane_id);
+                overlay_formats.push_back(formats);
+            }
+        }
+        drmModeFreePlane(p);
+    }
+    drmModePlaneResFree(res);
+}
+
+// The full state: mode, primary plane with screen[0], each overlay tile with its bufs[0].
+static int modeset(DrmGrid* g, uint32_t flags) {
+    drmModeAtomicReq* req = drmModeAtomicAlloc();
+    add_prop(g->fd, req, g->connector_id, DRM_MODE_OBJECT_CONNECTOR, "CRTC_ID", g->crtc_id);
+    add_prop(g->fd, req, g->crtc_id, DRM_MODE_OBJECT_CRTC, "MODE_ID", g->mode_blob);
+    add_prop(g->fd, req, g->crtc_id, DRM_MODE_OBJECT_CRTC, "ACTIVE", 1);
+    add_plane(g->fd, req, g->primary_plane, g->crtc_id, g->screen[0].fb_id, g->width, g->height,
+              TileRect {0, 0, g->width, g->height});
+    for (const auto& t : g->tiles) {
+        if (t->plane_id) add_plane(g->fd, req, t->plane_id, g->crtc_id, t->bufs[0].fb_id, t->rect.w, t->rect.h, t->rect);
+    }
+    int ret = drmModeAtomicCommit(g->fd, req, flags | DRM_MODE_ATOMIC_ALLOW_MODESET, nullptr);
+    drmModeAtomicFree(req);
+    return ret;
+}
+
+static void release_plane(DrmGrid* g, DrmTile& t) {
+    for (DrmBuffer& b : t.bufs) destroy_buffer(g->fd, &b);
+    t.plane_id = 0;
+    t.path = TilePath::Copy;
+}
+
+// ---- Render thread ----
+
+static void on_flip(int /*fd*/, unsigned /*sequence*/, unsigned sec, unsigned usec, void* user_data) {
+    DrmGrid* g = static_cast<DrmGrid*>(user_data);
+    g->flip_pending = false;
+    // Flip timestamps are CLOCK_MONOTONIC, like g_get_monotonic_time()
+    const gint64 shown_us = (gint64)sec * G_USEC_PER_SEC + usec;
+    for (const auto& t : g->tiles) {
+        if (!t->flip_arrival_us) continue;
+        if (t->metrics) stream_metrics_display_age(t->metrics, shown_us - t->flip_arrival_us);
+        t->flip_arrival_us = 0;
+    }
+}
+
+static void wait_flip(DrmGrid* g) {
+    drmEventContext ev {};
+    ev.version = 2;
+    ev.page_flip_handler = on_flip;
+    pollfd pfd {g->fd, POLLIN, 0};
+    while (g->flip_pending && g->running.load(std::memory_order_relaxed)) {
+        int n = poll(&pfd, 1, 100);
+        if (n > 0) drmHandleEvent(g->fd, &ev);
+        else if (n < 0 && errno != EINTR) break;
+    }
+    g->flip_pending = false;
+}
+
+static void wait_vblank(DrmGrid* g) {
+    drmVBlank vbl {};
+    vbl.request.type = (drmVBlankSeqType)(DRM_VBLANK_RELATIVE |
+                                          ((g->crtc_index << DRM_VBLANK_HIGH_CRTC_SHIFT) & DRM_VBLANK_HIGH_CRTC_MASK));
+    vbl.request.sequence = 1;
+    if (drmWaitVBlank(g->fd, &vbl) != 0) g_usleep(G_USEC_PER_SEC / std::max(g->refresh_hz, 1));
+}
+
+static void bump(StreamMetrics* m, std::atomic<guint64> StreamMetrics::*counter) {
+    if (m) (m->*counter).fetch_add(1, std::memory_order_relaxed);
+}
+
+static bool bgrx_at_tile_size(GstSample* sample, const DrmTile& t) {
+    GstVideoInfo info;
+    GstCaps* caps = gst_sample_get_caps(sample);
+    return caps && gst_video_info_from_caps(&info, caps) && GST_VIDEO_INFO_FORMAT(&info) == GST_VIDEO_FORMAT_BGRx &&
+           GST_VIDEO_INFO_WIDTH(&info) == t.rect.w && GST_VIDEO_INFO_HEIGHT(&info) == t.rect.h;
+}
+
+// Overlay tile with a new frame: its framebuffer (imported, or copied into the back scanout buffer)
+// into `req`. False when the frame cannot be shown.
+static bool overlay_frame(DrmGrid* g, DrmTile& t, GstSample* sample, drmModeAtomicReq* req) {
+    uint32_t fb = 0;
+    int src_w = t.rect.w, src_h = t.rect.h;
+    t.pending_copy = false;
+    // Frames still in the caps from before a renegotiation are skipped, not taken as a failure
+    if (t.path.load() == TilePath::ImportTile && !bgrx_at_tile_size(sample, t)) return false;
+    if (t.path.load() != TilePath::Copy) {
+        const DrmImport* im = import_frame(g, t, sample);
+        if (im && plane_accepts(g, t, *im)) {
+            fb = im->fb_id;
+            src_w = im->width;
+            src_h = im->height;
+            t.pending_sample = gst_sample_ref(sample);
+            bump(t.metrics, &StreamMetrics::zero_copy_frames);
+        } else {
+            step_down(t, im ? "the plane rejects the frame" : "frame not in an importable dmabuf");
+        }
+    }
+    if (!fb) {
+        DrmBuffer& b = t.bufs[t.back];
+        if (!blit(sample, b, 0, 0, b.width, b.height)) return false;
+        fb = b.fb_id;
+        t.pending_copy = true;
+        bump(t.metrics, &StreamMetrics::display_copies);
+    }
+    drmModeAtomicAddProperty(req, t.plane_id, t.plane_fb_prop, fb);
+    drmModeAtomicAddProperty(req, t.plane_id, t.plane_src_w_prop, (uint64_t)src_w << 16);
+    drmModeAtomicAddProperty(req, t.plane_id, t.plane_src_h_prop, (uint64_t)src_h << 16);
+    t.pending_fb = fb;
+    return true;
+}
+
+// One refresh: copy or import what changed, commit, wait for the flip.
+static void render_once(DrmGrid* g) {
+    drmModeAtomicReq* req = drmModeAtomicAlloc();
+    std::vector<DrmTile*> overlays;
+    bool screen_changed = false;
+    for (const auto& tp : g->tiles) {
+        DrmTile& t = *tp;
+        if (const MailboxFrame* f = frame_mailbox_take(t.mailbox)) {
+            ++t.seq;
+            t.new_arrival_us = f->arrival_us;
+        }
+        GstSample* cur = frame_mailbox_current(t.mailbox)->sample;
+        if (!cur) continue;
+        if (t.plane_id) {
+            if (t.committed == t.seq) continue;  // on screen already
+            t.committed = t.seq;
+            if (overlay_frame(g, t, cur, req)) overlays.push_back(&t);
+        } else if (t.drawn[g->back ^ 1] != t.seq) {
+            screen_changed = true;
+        }
+    }
+    if (screen_changed) {
+        // The back screen is two refreshes old: bring every composed tile up to date, not only
+        // the ones that changed in this refresh
+        for (const auto& tp : g->tiles) {
+            DrmTile& t = *tp;
+            GstSample* cur = frame_mailbox_current(t.mailbox)->sample;
+            if (t.plane_id || !cur || t.drawn[g->back] == t.seq) continue;
+            if (blit(cur, g->screen[g->back], t.rect.x, t.rect.y, t.rect.w, t.rect.h)) {
+                bump(t.metrics, &StreamMetrics::display_copies);
+            }
+            t.drawn[g->back] = t.seq;
+        }
+        drmModeAtomicAddProperty(req, g->primary_plane, g->primary_fb_prop, g->screen[g->back].fb_id);
+    }
+    if (!screen_changed && overlays.empty()) {
+        drmModeAtomicFree(req);
+        g->idle_vblanks.fetch_add(1, std::memory_order_relaxed);
+        wait_vblank(g);
+        return;
+    }
+
+    for (const auto& t : g->tiles) {
+        t->flip_arrival_us = t->new_arrival_us;
+        t->new_arrival_us = 0;
+    }
+    g->flip_pending = true;
+    int ret = drmModeAtomicCommit(g->fd, req, DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT, g);
+    drmModeAtomicFree(req);
+    if (ret) {
+        g->flip_pending = false;
+        g_printerr("[drm] Commit failed: %s\n", std::strerror(-ret));
+        // Retry these frames next refresh; an import that passed the test commit is not trusted again
+        for (DrmTile* t : overlays) {
+            t->committed = 0;
+            if (t->pending_sample) {
+                gst_sample_unref(t->pending_sample);
+                t->pending_sample = nullptr;
+                step_down(*t, "commit failed");
+            }
+        }
+        g_usleep(G_USEC_PER_SEC / std::max(g->refresh_hz, 1));
+        return;
+    }
+    g->commits.fetch_add(1, std::memory_order_relaxed);
+    wait_flip(g);
+    // What was committed is on screen now: the frame it replaced can go back to its pool, and the
+    // next copies go into the other buffers
+    if (screen_changed) g->back ^= 1;
+    for (DrmTile* t : overlays) {
+        if (t->shown_sample) gst_sample_unref(t->shown_sample);
+        t->shown_sample = t->pending_sample;
+        t->pending_sample = nullptr;
+        t->shown_fb = t->pending_fb;
+        if (t->pending_copy) t->back ^= 1;
+    }
+}
+
+bool drm_grid_start(DrmGrid* g) {
+    std::vector<std::vector<uint32_t>> overlay_formats;
+    find_planes(g, overlay_formats);
+    if (!g->primary_plane) {
+        g_printerr("[drm] No primary plane for CRTC %u\n", g->crtc_id);
+        return false;
+    }
+    for (DrmBuffer& b : g->screen) {
+        if (!create_buffer(g->fd, g->width, g->height, &b)) {
+            g_printerr("[drm] Cannot allocate a %dx%d framebuffer\n", g->width, g->height);
+            return false;
+        }
+    }
+    g->primary_fb_prop = prop_id(g->fd, g->primary_plane, DRM_MODE_OBJECT_PLANE, "FB_ID");
+
+    // Overlay planes in tile order while there are planes and buffers
+    const char* env = std::getenv("GRID_DRM_PLANES");
+    const bool use_planes = !(env && std::strcmp(env, "0") == 0);
+    const char* dmabuf_env = std::getenv("GRID_DMABUF");
+    const bool import = !(dmabuf_env && std::strcmp(dmabuf_env, "0") == 0);
+    size_t next = 0;
+    for (const auto& tp : g->tiles) {
+        DrmTile& t = *tp;
+        if (!use_planes || next >= g->overlays.size()) break;
+        if (!create_buffer(g->fd, t.rect.w, t.rect.h, &t.bufs[0]) ||
+            !create_buffer(g->fd, t.rect.w, t.rect.h, &t.bufs[1])) {
+            release_plane(g, t);
+            break;
+        }
+        t.plane_formats = overlay_formats[next];
+        t.plane_id = g->overlays[next++];
+        t.plane_fb_prop = prop_id(g->fd, t.plane_id, DRM_MODE_OBJECT_PLANE, "FB_ID");
+        t.plane_src_w_prop = prop_id(g->fd, t.plane_id, DRM_MODE_OBJECT_PLANE, "SRC_W");
+        t.plane_src_h_prop = prop_id(g->fd, t.plane_id, DRM_MODE_OBJECT_PLANE, "SRC_H");
+        t.path = import ? TilePath::Import : TilePath::Copy;
+    }
+    // Drivers limit planes per CRTC (bandwidth, scalers): give them up from the last tile on
+    // until the layout passes a test commit
+    while (modeset(g, DRM_MODE_ATOMIC_TEST_ONLY) != 0) {
+        auto last = std::find_if(g->tiles.rbegin(), g->tiles.rend(), [](const std::unique_ptr<DrmTile>& t) {
+            return t->plane_id != 0;
+        });
+        if (last == g->tiles.rend()) break;
+        release_plane(g, **last);
+    }
+    int ret = modeset(g, 0);
+    if (ret) {
+        g_printerr("[drm] Modeset failed: %s (is another program the DRM master?)\n", std::strerror(-ret));
+        return false;
+    }
+    g->back = 1;
+    size_t on_planes = 0;
+    for (const auto& t : g->tiles) {
+        if (t->plane_id) {
+            t->back = 1;
+            t->shown_fb = t->bufs[0].fb_id;
+            ++on_planes;
+        }
+    }
+    g_print("[drm] %zu tiles on overlay planes (%s), %zu composed on the primary plane\n", on_planes,
+            import ? "dmabuf import" : "copied", g->tiles.size() - on_planes);
+
+    g->running = true;
+    g->thread = std::thread([g] {
+        while (g->running.load(std::memory_order_relaxed)) render_once(g);
+    });
+    return true;
+}
+
+GstElement* drm_grid_tile_sink(DrmGrid* g, size_t index, const std::string& name) {
+    DrmTile& t = *g->tiles[index];
+    GstCaps* caps = tile_caps(t);
+    GstElement* bin = frame_mailbox_tile_sink(t.mailbox, name, caps);
+    gst_caps_unref(caps);
+    if (!bin) return nullptr;
+    GstElement* sink = gst_bin_get_by_name(GST_BIN(bin), (name + "_appsink").c_str());
+    g_weak_ref_set(&t.sink, sink);
+    GstPad* pad = gst_element_get_static_pad(sink, "sink");
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM, on_allocation_query, &t, nullptr);
+    gst_object_unref(pad);
+    gst_object_unref(sink);
+    return bin;
+}
+
+void drm_grid_stop(DrmGrid* g) {
+    if (g->fd < 0) return;
+    if (g->thread.joinable()) {
+        g->running = false;
+        g->thread.join();
+    }
+    g_print("[drm] %" G_GUINT64_FORMAT " commits, %" G_GUINT64_FORMAT " idle vblanks\n", g->commits.load(),
+            g->idle_vblanks.load());
+    for (const auto& tp : g->tiles) {
+        DrmTile& t = *tp;
+        if (t.metrics) {
+            LatencyHistogram age;
+            stream_metrics_age(t.metrics, age);
+            g_print("[%s] %s, %" G_GUINT64_FORMAT " frames shown (%" G_GUINT64_FORMAT " zero-copy, %" G_GUINT64_FORMAT
+                    " converted, %" G_GUINT64_FORMAT " copied), %" G_GUINT64_FORMAT
+                    " dropped unseen, age at flip p50 %.1f ms p95 %.1f ms\n", t.metrics->name.c_str(),
+                    t.plane_id ? "overlay plane" : "composed", t.seq, t.metrics->zero_copy_frames.load(),
+                    t.metrics->convert_copies.load(), t.metrics->display_copies.load(), t.mailbox->dropped.load(),
+                    latency_quantile_ms(age, 0.50), latency_quantile_ms(age, 0.95));
+        }
+        drop_imports(g->fd, t, [](const DrmImport&) { return true; });
+        release_plane(g, t);
+    }
+    // Removing the framebuffers turns their planes off
+    for (DrmBuffer& b : g->screen) destroy_buffer(g->fd, &b);
+    if (g->mode_blob) drmModeDestroyPropertyBlob(g->fd, g->mode_blob);
+    close(g->fd);
+    g->fd = -1;
+}
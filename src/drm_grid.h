@@ -0,0 +1,152 @@
+// drm_grid.h
+// One DRM/KMS sink for the whole kiosk grid: this process owns the display and shows the newest
+// frame of every tile.
+//
+// A kmssink per camera means N elements that each want the CRTC: with `render-rectangle` they all
+// commit the primary plane in turn (the last commit wins, the others flicker), and pinning a
+// `plane-id` per sink makes them fight over the CRTC. Here the camera pipelines end in a frame
+// mailbox (frame_mailbox.h) and one thread drives the device with atomic commits:
+//
+//   - Tiles get a hardware overlay plane each, as long as the CRTC has overlay planes that take
+//     XRGB8888 and a test commit accepts the layout. The plane scans the tile out at its rectangle.
+//   - The remaining tiles are composed into a double-buffered dumb framebuffer on the primary plane
+//     (row copies only: the tile pipelines already scale to the tile size).
+//   - All changes of a refresh go into one commit with a page-flip event, and the next commit
+//     waits for that event: at most one update per vblank, never a torn or half-updated grid.
+//     With nothing new the thread sleeps until the next vblank.
+//
+// Overlay tiles are zero-copy where the hardware allows it. Their sink (drm_grid_tile_sink) prefers
+// memory:DMABuf caps in every format the plane can scan out, at any size (the plane scales), so
+// videoconvert and videoscale stay in passthrough; upstream elements that allocate from downstream
+// get dumb buffers exported as dmabufs. A dmabuf frame is imported as a framebuffer (cached per
+// buffer) and put on the plane as is, and kept referenced until the next flip replaced it. When an
+// import or a test commit fails, the tile renegotiates once to BGRx at the tile size (still from
+// the dumb-buffer pool), and copies into its own scanout buffers if even that does not arrive as
+// a dmabuf. Metrics count both: grid_zero_copy_frames_total and grid_frame_copies_total.
+//
+// The age of each new frame is recorded at the flip that put it on screen (metrics display age).
+// Works headless against vkms (`modprobe vkms enable_overlay=1`), see grid_drm_test.
+//
+// $GRID_DRM_DEVICE picks the card (default: the first one with a connected connector),
+// $GRID_DRM_PLANES=0 composes every tile on the primary plane, $GRID_DMABUF=0 turns the import
+// off (BGRx at the tile size, copied, as before).
+#pragma once
+
+#include <gst/gst.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frame_mailbox.h"
+#include "stream_set.h"
+
+struct StreamMetrics;
+struct DrmGrid;
+
+struct DrmBuffer {
+    uint32_t handle {0};
+    uint32_t fb_id {0};
+    uint32_t pitch {0};
+    uint64_t size {0};
+    int width {0};
+    int height {0};
+    uint8_t* map {nullptr};
+};
+
+// A dmabuf frame imported as a framebuffer, reused while the decoder recycles its buffers
+struct DrmImport {
+    uint32_t handles[4] {};
+    uint32_t pitches[4] {};
+    uint32_t offsets[4] {};
+    uint32_t fourcc {0};
+    uint64_t modifier {0};
+    int width {0};
+    int height {0};
+    uint32_t fb_id {0};
+};
+
+// How an overlay tile gets its frames onto the plane; only ever steps down
+enum class TilePath {
+    Import,      // importable formats at any size, decoder dmabufs scanned out directly
+    ImportTile,  // BGRx at the tile size from the dumb-buffer pool, scanned out directly
+    Copy,        // BGRx at the tile size, copied into the tile's scanout buffers
+};
+
+struct DrmTile {
+    DrmGrid* grid {nullptr};
+    FrameMailbox* mailbox {nullptr};
+    StreamMetrics* metrics {nullptr};
+    TileRect rect;
+    std::atomic<TilePath> path {TilePath::Copy};  // read by the pipeline's threads
+    GWeakRef sink {};                             // current appsink, for renegotiation
+
+    // Render thread only
+    uint32_t plane_id {0};       // overlay plane, 0 = composed on the primary plane
+    uint32_t plane_fb_prop {0};
+    uint32_t plane_src_w_prop {0};
+    uint32_t plane_src_h_prop {0};
+    std::vector<uint32_t> plane_formats;
+    DrmBuffer bufs[2];           // overlay scanout buffers (Copy path)
+    int back {0};
+    std::vector<DrmImport> imports;
+    DrmImport tested;            // layout that last passed a test commit on the plane
+    guint64 seq {0};             // frames taken from the mailbox
+    guint64 drawn[2] {};         // seq last copied into screen[] (composed)
+    guint64 committed {0};       // seq last committed (overlay)
+    uint32_t shown_fb {0};       // on screen, and committed waiting for the flip (overlay)
+    uint32_t pending_fb {0};
+    GstSample* shown_sample {nullptr};  // imported frames stay referenced while scanned out
+    GstSample* pending_sample {nullptr};
+    bool pending_copy {false};
+    gint64 new_arrival_us {0};   // taken, not committed yet
+    gint64 flip_arrival_us {0};  // committed, waiting for the flip
+
+    ~DrmTile();
+};
+
+struct DrmGrid {
+    std::string device;
+    int fd {-1};
+    uint32_t connector_id {0};
+    uint32_t crtc_id {0};
+    int crtc_index {0};
+    uint32_t mode_blob {0};
+    int width {0};
+    int height {0};
+    int refresh_hz {0};
+
+    uint32_t primary_plane {0};
+    uint32_t primary_fb_prop {0};
+    std::vector<uint32_t> overlays;  // free overlay planes of the CRTC that take XRGB8888
+    DrmBuffer screen[2];
+    int back {0};
+    std::vector<std::unique_ptr<DrmTile>> tiles;
+
+    std::thread thread;
+    std::atomic<bool> running {false};
+    bool flip_pending {false};
+    std::atomic<guint64> commits {0};
+    std::atomic<guint64> idle_vblanks {0};
+};
+
+// Opens the device and picks the connector, its preferred mode and a CRTC. False (and logs why)
+// when there is no usable display or the driver has no atomic modesetting.
+bool drm_grid_open(DrmGrid* g);
+
+// Tiles in screen coordinates (g->width x g->height), added before drm_grid_start().
+void drm_grid_add_tile(DrmGrid* g, FrameMailbox* mb, const TileRect& rect, StreamMetrics* m = nullptr);
+
+// Allocates the framebuffers, assigns overlay planes, sets the mode and starts the render thread.
+bool drm_grid_start(DrmGrid* g);
+
+// The sink for tile `index` (after drm_grid_start): videoconvert ! videoscale ! appsink into the
+// tile's mailbox, with the caps and buffer pool of the tile's path. One per pipeline build; the
+// decoder links to its "sink" pad.
+GstElement* drm_grid_tile_sink(DrmGrid* g, size_t index, const std::string& name);
+
+// Stops the render thread, frees the framebuffers and closes the device; logs what was shown.
+void drm_grid_stop(DrmGrid* g);
@@ -0,0 +1,407 @@
+// fake_camera.cpp
+#include "fake_camera.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+struct FakeEncoder {
+    const char* codec;
+    const char* factory;
+    const char* args;     // printf format: key frame interval (frames), bitrate (kbit/s)
+    const char* payloader;
+};
+
+// First installed one per codec is used; software encoders first so the stream is the same on
+// every CI box.
+static const FakeEncoder kEncoders[] = {
+    { "H264", "x264enc", "tune=zerolatency speed-preset=ultrafast key-int-max=%d bitrate=%d", "rtph264pay" },
+    { "H264", "openh264enc", "gop-size=%d bitrate=%d000", "rtph264pay" },
+    { "H264", "vah264enc", "key-int-max=%d bitrate=%d", "rtph264pay" },
+    { "H265", "x265enc", "tune=zerolatency speed-preset=ultrafast key-int-max=%d bitrate=%d", "rtph265pay" },
+    { "H265", "vah265enc", "key-int-max=%d bitrate=%d", "rtph265pay" },
+};
+
+const char* const kFakeCameraUsage =
+    "  cameras:     [--streams N] [--codec h264|h265] [--size WxH] [--fps F] [--gop G] [--bitrate KBPS]\n"
+    "  server:      [--address A] [--port P] [--protocols tcp|udp|tcp,udp]\n"
+    "  impairments: [--loss PCT] [--jitter MS] [--bandwidth KBPS] [--eos-every S]\n"
+    "               [--disconnect-every S] [--down S] [--seed N]\n";
+
+FakeMount::~FakeMount() {
+    if (rand) g_rand_free(rand);
+}
+
+static bool factory_installed(const char* name) {
+    GstElementFactory* f = gst_element_factory_find(name);
+    if (!f) return false;
+    gst_object_unref(f);
+    return true;
+}
+
+bool fake_camera_parse_arg(int argc, char** argv, int& i, FakeCameraOptions& o) {
+    const char* a = argv[i];
+    if (i + 1 >= argc || std::strncmp(a, "--", 2) != 0) return false;
+    const char* v = argv[i + 1];
+    if (std::strcmp(a, "--streams") == 0) o.cameras = std::atoi(v);
+    else if (std::strcmp(a, "--fps") == 0) o.fps = std::atoi(v);
+    else if (std::strcmp(a, "--gop") == 0) o.gop = std::atoi(v);
+    else if (std::strcmp(a, "--bitrate") == 0) o.bitrate_kbps = std::atoi(v);
+    else if (std::strcmp(a, "--address") == 0) o.address = v;
+    else if (std::strcmp(a, "--port") == 0) o.port = std::atoi(v);
+    else if (std::strcmp(a, "--protocols") == 0) o.protocols = v;
+    else if (std::strcmp(a, "--loss") == 0) o.impair.loss_pct = std::atof(v);
+    else if (std::strcmp(a, "--jitter") == 0) o.impair.jitter_ms = std::atoi(v);
+    else if (std::strcmp(a, "--bandwidth") == 0) o.impair.bandwidth_kbps = std::atoi(v);
+    else if (std::strcmp(a, "--eos-every") == 0) o.impair.eos_every_s = std::atoi(v);
+    else if (std::strcmp(a, "--disconnect-every") == 0) o.impair.disconnect_every_s = std::atoi(v);
+    else if (std::strcmp(a, "--down") == 0) o.impair.down_s = std::atoi(v);
+    else if (std::strcmp(a, "--seed") == 0) o.seed = (guint32)std::strtoul(v, nullptr, 10);
+    else if (std::strcmp(a, "--codec") == 0) {
+        std::string c = v;
+        for (char& ch : c) ch = (char)g_ascii_toupper(ch);
+        o.codec = c;
+    } else if (std::strcmp(a, "--size") == 0) {
+        if (std::sscanf(v, "%dx%d", &o.width, &o.height) != 2) o.width = o.height = 0;
+    } else {
+        return false;
+    }
+    ++i;
+    return true;
+}
+
+bool fake_camera_options_valid(const FakeCameraOptions& o) {
+    const FakeImpairments& im = o.impair;
+    bool proto = o.protocols.find("tcp") != std::string::npos || o.protocols.find("udp") != std::string::npos;
+    return o.cameras > 0 && o.fps > 0 && o.gop > 0 && o.bitrate_kbps > 0 && o.width > 0 && o.height > 0 &&
+           o.port >= 0 && o.port <= 65535 && (o.codec == "H264" || o.codec == "H265") && proto &&
+           im.loss_pct >= 0.0 && im.loss_pct <= 100.0 && im.jitter_ms >= 0 && im.bandwidth_kbps >= 0 &&
+           im.eos_every_s >= 0 && im.disconnect_every_s >= 0 && im.down_s >= 0;
+}
+
+std::string fake_camera_launch(const FakeCameraOptions& o, std::string* encoder) {
+    for (const FakeEncoder& e : kEncoders) {
+        if (o.codec != e.codec || !factory_installed(e.factory)) continue;
+        gchar* args = g_strdup_printf(e.args, o.gop, o.bitrate_kbps);
+        // Scrolling SMPTE bars: every frame changes, so P-frames are not empty. Jitter and the
+        // bandwidth cap hold the payloader thread; the queue keeps the encoder running meanwhile.
+        gchar* launch = g_strdup_printf(
+            "( videotestsrc is-live=true pattern=smpte horizontal-speed=2 "
+            "! video/x-raw,width=%d,height=%d,framerate=%d/1 "
+            "! %s %s %s! %s name=pay0 pt=96 config-interval=-1 )",
+            o.width, o.height, o.fps, e.factory, args,
+            o.impair.any() ? "! queue max-size-buffers=0 max-size-bytes=0 max-size-time=2000000000 " : "",
+            e.payloader);
+        std::string s = launch;
+        g_free(launch);
+        g_free(args);
+        if (encoder) *encoder = e.factory;
+        return s;
+    }
+    return std::string();
+}
+
+// ---- Impairments (payloader src pad, streaming thread) ----
+
+static void sleep_until(gint64 due_us) {
+    gint64 now = g_get_monotonic_time();
+    if (due_us > now) g_usleep((gulong)(due_us - now));
+}
+
+// False: drop the packet.
+static bool impair_packet(FakeMount* fm, GstBuffer* buf) {
+    const FakeImpairments& im = fm->owner->opts.impair;
+    fm->packets.fetch_add(1, std::memory_order_relaxed);
+    if (fm->stalled.load(std::memory_order_relaxed)) {
+        fm->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (g_get_monotonic_time() < fm->owner->down_until_us.load()) {
+        fm->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;  // UDP sessions outlive the closed connection: keep them silent too
+    }
+
+    if (im.jitter_ms > 0) {
+        guint64 pts = GST_BUFFER_PTS(buf);
+        if (GST_CLOCK_TIME_IS_VALID(pts) && pts != fm->last_pts) {
+            // New frame: due at its nominal time (PTS spacing from the first frame) plus 0..jitter
+            gint64 now = g_get_monotonic_time();
+            if (!GST_CLOCK_TIME_IS_VALID(fm->pts0) || pts < fm->pts0) {
+                fm->pts0 = pts;
+                fm->t0_us = now;
+            }
+            fm->frame_due_us = fm->t0_us + (gint64)((pts - fm->pts0) / 1000) +
+                               g_rand_int_range(fm->rand, 0, im.jitter_ms * 1000 + 1);
+            fm->last_pts = pts;
+        }
+        sleep_until(fm->frame_due_us);
+    }
+
+    if (im.loss_pct > 0.0 && g_rand_double(fm->rand) * 100.0 < im.loss_pct) {
+        fm->dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    if (im.bandwidth_kbps > 0) {
+        gint64 at = std::max(g_get_monotonic_time(), fm->budget_us);
+        fm->budget_us = at + (gint64)gst_buffer_get_size(buf) * 8000 / im.bandwidth_kbps;
+        sleep_until(at);
+    }
+    return true;
+}
+
+static gboolean impair_list_item(GstBuffer** buf, guint /*idx*/, gpointer user_data) {
+    if (!impair_packet(static_cast<FakeMount*>(user_data), *buf)) {
+        gst_buffer_unref(*buf);
+        *buf = nullptr;  // removed from the list
+    }
+    return TRUE;
+}
+
+static GstPadProbeReturn on_payloader_output(GstPad* pad, GstPadProbeInfo* info, gpointer user_data) {
+    FakeMount* fm = static_cast<FakeMount*>(user_data);
+    if (fm->eos_pending.exchange(false)) {
+        g_print("[fakecam] cam%d: EOS\n", fm->index + 1);
+        gst_pad_push_event(pad, gst_event_new_eos());
+        return GST_PAD_PROBE_DROP;
+    }
+    if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+        return impair_packet(fm, GST_PAD_PROBE_INFO_BUFFER(info)) ? GST_PAD_PROBE_OK : GST_PAD_PROBE_DROP;
+    }
+    if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+        GstBufferList* list = gst_buffer_list_make_writable(GST_PAD_PROBE_INFO_BUFFER_LIST(info));
+        gst_buffer_list_foreach(list, impair_list_item, fm);
+        info->data = list;
+        if (gst_buffer_list_length(list) == 0) return GST_PAD_PROBE_DROP;
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+// A new media (pipeline) for the mount: start the impairments from scratch on its payloader.
+static void on_media_configure(GstRTSPMediaFactory* /*factory*/, GstRTSPMedia* media, gpointer user_data) {
+    FakeMount* fm = static_cast<FakeMount*>(user_data);
+    fm->pts0 = fm->last_pts = GST_CLOCK_TIME_NONE;
+    fm->budget_us = 0;
+    fm->eos_pending = false;
+
+    GstElement* element = gst_rtsp_media_get_element(media);
+    GstElement* pay = gst_bin_get_by_name(GST_BIN(element), "pay0");
+    if (pay) {
+        GstPad* pad = gst_element_get_static_pad(pay, "src");
+        gst_pad_add_probe(pad, (GstPadProbeType)(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST),
+                          on_payloader_output, fm, nullptr);
+        gst_object_unref(pad);
+        gst_object_unref(pay);
+    }
+    gst_object_unref(element);
+}
+
+// ---- Schedule (server thread) ----
+
+static GstRTSPFilterResult remove_client(GstRTSPServer* /*server*/, GstRTSPClient* /*client*/, gpointer /*data*/) {
+    return GST_RTSP_FILTER_REMOVE;
+}
+
+static void on_client_connected(GstRTSPServer* /*server*/, GstRTSPClient* client, gpointer user_data) {
+    FakeCameraServer* s = static_cast<FakeCameraServer*>(user_data);
+    if (g_get_monotonic_time() < s->down_until_us.load()) gst_rtsp_client_close(client);
+}
+
+static gboolean schedule_tick(gpointer user_data) {
+    FakeCameraServer* s = static_cast<FakeCameraServer*>(user_data);
+    const FakeImpairments& im = s->opts.impair;
+    gint64 now = g_get_monotonic_time();
+    if (im.eos_every_s > 0 && now >= s->next_eos_us) {
+        s->next_eos_us = now + (gint64)im.eos_every_s * G_USEC_PER_SEC;
+        for (auto& fm : s->mounts) fm->eos_pending = true;
+    }
+    if (im.disconnect_every_s > 0 && now >= s->next_disconnect_us) {
+        s->next_disconnect_us = now + (gint64)im.disconnect_every_s * G_USEC_PER_SEC;
+        s->down_until_us = now + (gint64)im.down_s * G_USEC_PER_SEC;
+        s->disconnects.fetch_add(1, std::memory_order_relaxed);
+        g_print("[fakecam] Closing every client connection, refusing new ones for %d s\n", im.down_s);
+        gst_rtsp_server_client_filter(s->server, remove_client, nullptr);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+// Sessions of clients that went away without TEARDOWN (UDP) expire here, not by themselves.
+static gboolean session_cleanup_tick(gpointer user_data) {
+    FakeCameraServer* s = static_cast<FakeCameraServer*>(user_data);
+    GstRTSPSessionPool* pool = gst_rtsp_server_get_session_pool(s->server);
+    gst_rtsp_session_pool_cleanup(pool);
+    g_object_unref(pool);
+    return G_SOURCE_CONTINUE;
+}
+
+// True if one of the client's sessions plays exactly `path` ("/cam1" must not match "/cam10").
+static bool client_plays(GstRTSPClient* client, const char* path) {
+    bool found = false;
+    GList* sessions = gst_rtsp_client_session_filter(client, nullptr, nullptr);
+    for (GList* l = sessions; l && !found; l = l->next) {
+        GList* medias = gst_rtsp_session_filter(GST_RTSP_SESSION(l->data), nullptr, nullptr);
+        for (GList* m = medias; m && !found; m = m->next) {
+            gint matched = 0;
+            found = gst_rtsp_session_media_matches(GST_RTSP_SESSION_MEDIA(m->data), path, &matched) &&
+                    matched == (gint)std::strlen(path);
+        }
+        g_list_free_full(medias, g_object_unref);
+    }
+    g_list_free_full(sessions, g_object_unref);
+    return found;
+}
+
+static GstRTSPFilterResult remove_client_of(GstRTSPServer* /*server*/, GstRTSPClient* client, gpointer data) {
+    return client_plays(client, static_cast<const char*>(data)) ? GST_RTSP_FILTER_REMOVE : GST_RTSP_FILTER_KEEP;
+}
+
+struct DropRequest {
+    FakeCameraServer* server;
+    std::string path;
+};
+
+static gboolean drop_clients_cb(gpointer user_data) {
+    DropRequest* r = static_cast<DropRequest*>(user_data);
+    gst_rtsp_server_client_filter(r->server->server, remove_client_of, (gpointer)r->path.c_str());
+    return G_SOURCE_REMOVE;
+}
+
+void fake_camera_end_stream(FakeCameraServer* s, int index) {
+    if (index >= 0 && index < (int)s->mounts.size()) s->mounts[index]->eos_pending = true;
+}
+
+void fake_camera_drop_clients(FakeCameraServer* s, int index) {
+    if (!s->ctx) return;
+    DropRequest* r = new DropRequest{ s, "/cam" + std::to_string(index + 1) };
+    g_main_context_invoke_full(s->ctx, G_PRIORITY_DEFAULT, drop_clients_cb, r,
+                               [](gpointer p) { delete static_cast<DropRequest*>(p); });
+}
+
+void fake_camera_stall(FakeCameraServer* s, int index, bool stalled) {
+    if (index >= 0 && index < (int)s->mounts.size()) s->mounts[index]->stalled = stalled;
+}
+
+// Runs on the server thread: close the sessions, stop accepting, leave the loop.
+static gboolean stop_cb(gpointer user_data) {
+    FakeCameraServer* s = static_cast<FakeCameraServer*>(user_data);
+    gst_rtsp_server_client_filter(s->server, remove_client, nullptr);
+    GSource* src = g_main_context_find_source_by_id(s->ctx, s->source_id);
+    if (src) g_source_destroy(src);
+    g_main_loop_quit(s->loop);
+    return G_SOURCE_REMOVE;
+}
+
+static GstRTSPLowerTrans lower_transports(const std::string& protocols) {
+    int t = 0;
+    if (protocols.find("tcp") != std::string::npos) t |= GST_RTSP_LOWER_TRANS_TCP;
+    if (protocols.find("udp") != std::string::npos) t |= GST_RTSP_LOWER_TRANS_UDP;
+    return (GstRTSPLowerTrans)t;
+}
+
+bool fake_camera_start(FakeCameraServer* s, const FakeCameraOptions& o) {
+    s->opts = o;
+    const std::string launch = fake_camera_launch(o, &s->encoder);
+    if (launch.empty()) {
+        g_printerr("[fakecam] No %s encoder installed (x264enc, x265enc, openh264enc, va)\n", o.codec.c_str());
+        return false;
+    }
+
+    s->server = gst_rtsp_server_new();
+    gst_rtsp_server_set_address(s->server, o.address.c_str());
+    gchar* service = g_strdup_printf("%d", o.port);
+    gst_rtsp_server_set_service(s->server, service);
+    g_free(service);
+    g_signal_connect(s->server, "client-connected", G_CALLBACK(on_client_connected), s);
+
+    GstRTSPMountPoints* mounts = gst_rtsp_server_get_mount_points(s->server);
+    s->mounts.clear();
+    for (int i = 0; i < o.cameras; ++i) {
+        auto fm = std::make_unique<FakeMount>();
+        fm->owner = s;
+        fm->index = i;
+        fm->rand = g_rand_new_with_seed(o.seed + (guint32)i);
+
+        GstRTSPMediaFactory* factory = gst_rtsp_media_factory_new();
+        gst_rtsp_media_factory_set_launch(factory, launch.c_str());
+        gst_rtsp_media_factory_set_protocols(factory, lower_transports(o.protocols));
+        // One encoder per mount, kept while a client is connected (a reconnect reuses it)
+        gst_rtsp_media_factory_set_shared(factory, TRUE);
+        g_signal_connect(factory, "media-configure", G_CALLBACK(on_media_configure), fm.get());
+        gchar* path = g_strdup_printf("/cam%d", i + 1);
+        gst_rtsp_mount_points_add_factory(mounts, path, factory);  // takes the factory
+        g_free(path);
+        s->mounts.push_back(std::move(fm));
+    }
+    g_object_unref(mounts);
+
+    GError* err = nullptr;
+    GSource* source = gst_rtsp_server_create_source(s->server, nullptr, &err);
+    if (!source) {
+        g_printerr("[fakecam] Cannot listen on %s:%d: %s\n", o.address.c_str(), o.port, err ? err->message : "?");
+        if (err) g_error_free(err);
+        g_object_unref(s->server);
+        s->server = nullptr;
+        s->mounts.clear();
+        return false;
+    }
+    s->ctx = g_main_context_new();
+    s->source_id = g_source_attach(source, s->ctx);
+    g_source_unref(source);
+
+    const FakeImpairments& im = o.impair;
+    gint64 now = g_get_monotonic_time();
+    s->next_eos_us = now + (gint64)im.eos_every_s * G_USEC_PER_SEC;
+    s->next_disconnect_us = now + (gint64)im.disconnect_every_s * G_USEC_PER_SEC;
+    GSource* cleanup = g_timeout_source_new_seconds(2);
+    g_source_set_callback(cleanup, session_cleanup_tick, s, nullptr);
+    g_source_attach(cleanup, s->ctx);
+    g_source_unref(cleanup);
+    if (im.eos_every_s > 0 || im.disconnect_every_s > 0) {
+        GSource* tick = g_timeout_source_new(250);
+        g_source_set_callback(tick, schedule_tick, s, nullptr);
+        g_source_attach(tick, s->ctx);
+        g_source_unref(tick);
+    }
+
+    // Clients on this machine use 127.0.0.1 when the server listens on every interface
+    const std::string host = (o.address == "0.0.0.0" || o.address == "::") ? "127.0.0.1" : o.address;
+    int port = gst_rtsp_server_get_bound_port(s->server);
+    s->urls.clear();
+    for (int i = 0; i < o.cameras; ++i) {
+        s->urls.push_back("rtsp://" + host + ":" + std::to_string(port) + "/cam" + std::to_string(i + 1));
+    }
+
+    s->loop = g_main_loop_new(s->ctx, FALSE);
+    s->thread = std::thread([s] {
+        g_main_context_push_thread_default(s->ctx);
+        g_main_loop_run(s->loop);
+        g_main_context_pop_thread_default(s->ctx);
+    });
+    g_print("[fakecam] %d x %s %dx%d@%d (%s, GOP %d, %d kbit/s) on rtsp://%s:%d/cam1..%d (%s)\n",
+            o.cameras, o.codec.c_str(), o.width, o.height, o.fps, s->encoder.c_str(), o.gop, o.bitrate_kbps,
+            host.c_str(), port, o.cameras, o.protocols.c_str());
+    if (im.any()) {
+        g_print("[fakecam] Impairments: loss %.1f%%, jitter %d ms, bandwidth %d kbit/s, EOS every %d s, "
+                "disconnect every %d s (down %d s), seed %u\n",
+                im.loss_pct, im.jitter_ms, im.bandwidth_kbps, im.eos_every_s, im.disconnect_every_s, im.down_s,
+                o.seed);
+    }
+    return true;
+}
+
+void fake_camera_stop(FakeCameraServer* s) {
+    if (!s->server) return;
+    g_main_context_invoke(s->ctx, stop_cb, s);
+    if (s->thread.joinable()) s->thread.join();
+    g_main_loop_unref(s->loop);
+    g_object_unref(s->server);
+    g_main_context_unref(s->ctx);
+    s->loop = nullptr;
+    s->server = nullptr;
+    s->ctx = nullptr;
+    s->source_id = 0;
+    s->urls.clear();
+    // Media pipelines may still be shutting down in the server's thread pool and hold the mounts
+    // through their probes; the FakeMount objects are released with the FakeCameraServer.
+}
@@ -0,0 +1,122 @@
+// fake_camera.h
+// In-process RTSP server with synthetic cameras (gst-rtsp-server), for benchmarks and tests that
+// must run without real cameras or a network.
+//
+// Every camera is its own mount, /cam1 ... /camN, with its own live encoder
+// (videotestsrc ! <first installed encoder> ! rtph26xpay), so N cameras cost N encoders like N
+// real ones would. RTP goes over TCP (interleaved) or UDP, whichever the client asks for. The
+// server runs its own GMainContext on a thread, so it can be used from any main loop, or none.
+//
+// Impairments reproduce a bad camera or link, applied to every mount by a probe on the payloader
+// output:
+//   loss       drop each RTP packet with a probability
+//   jitter     delay each frame by a random 0..N ms (frames stay in order, a queue before the
+//              payloader absorbs the delay)
+//   bandwidth  token bucket on the RTP bytes; above it frames queue up, then the live source drops
+//   EOS        every N s each stream ends with EOS (rtspsrc sees BYE, then EOS)
+//   disconnect every N s every client connection is closed, and new ones are refused for M s
+#pragma once
+
+#include <gst/rtsp-server/rtsp-server.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct FakeImpairments {
+    double loss_pct {0.0};
+    int jitter_ms {0};
+    int bandwidth_kbps {0};      // 0 = unlimited
+    int eos_every_s {0};         // 0 = never
+    int disconnect_every_s {0};  // 0 = never
+    int down_s {0};              // refuse connections for this long after a disconnect
+
+    bool any() const {
+        return loss_pct > 0.0 || jitter_ms > 0 || bandwidth_kbps > 0 || eos_every_s > 0 || disconnect_every_s > 0;
+    }
+};
+
+struct FakeCameraOptions {
+    int cameras {4};
+    std::string codec {"H264"};  // "H264" or "H265"
+    int width {1280};
+    int height {720};
+    int fps {25};
+    int gop {50};                // frames between keyframes
+    int bitrate_kbps {2000};
+    std::string address {"127.0.0.1"};
+    int port {8554};             // 0 = any free port
+    std::string protocols {"tcp,udp"};  // lower transports offered: "tcp", "udp" or both
+    FakeImpairments impair;
+    guint32 seed {1};            // loss/jitter random sequence, per mount seed + index
+};
+
+struct FakeCameraServer;
+
+// Streaming-thread state of one mount (impairments).
+struct FakeMount {
+    FakeCameraServer* owner {nullptr};
+    int index {0};
+    GRand* rand {nullptr};
+    std::atomic<bool> eos_pending {false};
+    std::atomic<bool> stalled {false};
+    std::atomic<guint64> packets {0};
+    std::atomic<guint64> dropped {0};
+
+    // Reset for every new media of the mount
+    guint64 pts0 {GST_CLOCK_TIME_NONE};
+    guint64 last_pts {GST_CLOCK_TIME_NONE};
+    gint64 t0_us {0};
+    gint64 frame_due_us {0};
+    gint64 budget_us {0};
+
+    ~FakeMount();
+};
+
+struct FakeCameraServer {
+    FakeCameraOptions opts;
+    std::string encoder;             // encoder factory in use
+    std::vector<std::string> urls;   // rtsp://<address>:<port>/camN
+    std::vector<std::unique_ptr<FakeMount>> mounts;
+
+    GstRTSPServer* server {nullptr};
+    GMainContext* ctx {nullptr};
+    GMainLoop* loop {nullptr};
+    guint source_id {0};
+    std::thread thread;
+
+    gint64 next_eos_us {0};
+    gint64 next_disconnect_us {0};
+    std::atomic<gint64> down_until_us {0};
+    std::atomic<guint64> disconnects {0};
+};
+
+// Handles one server option at argv[i] (advancing i past its value): --streams N,
+// --codec h264|h265, --size WxH, --fps F, --gop G, --bitrate KBPS, --address A, --port P,
+// --protocols tcp|udp|tcp,udp, --loss PCT, --jitter MS, --bandwidth KBPS, --eos-every S,
+// --disconnect-every S, --down S, --seed N. False if argv[i] is not one of them.
+bool fake_camera_parse_arg(int argc, char** argv, int& i, FakeCameraOptions& o);
+bool fake_camera_options_valid(const FakeCameraOptions& o);
+extern const char* const kFakeCameraUsage;
+
+// Launch line of one mount, "( videotestsrc ... ! rtph264pay name=pay0 pt=96 )"; empty when no
+// encoder for the codec is installed.
+std::string fake_camera_launch(const FakeCameraOptions& o, std::string* encoder = nullptr);
+
+// Binds <address>:<port> and starts serving. False (and logs why) when no encoder is installed or
+// the port cannot be bound.
+bool fake_camera_start(FakeCameraServer* s, const FakeCameraOptions& o);
+
+// Disconnects every client and stops the server thread.
+void fake_camera_stop(FakeCameraServer* s);
+
+// On-demand faults for one camera (0-based), for tests that drive their own schedule.
+// End the stream with EOS (the client sees RTCP BYE, then EOS):
+void fake_camera_end_stream(FakeCameraServer* s, int index);
+// Close the connections of the clients playing it (the client sees a read error):
+void fake_camera_drop_clients(FakeCameraServer* s, int index);
+// Freeze it: the session stays up (RTSP keep-alives and RTCP still answered) but no RTP is sent
+// until it is resumed, like a camera whose encoder hung:
+void fake_camera_stall(FakeCameraServer* s, int index, bool stalled);
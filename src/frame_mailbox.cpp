@@ -0,0 +1,113 @@
+// frame_mailbox.cpp
+#include "frame_mailbox.h"
+
+#include "convert_chain.h"
+#include "metrics.h"
+
+static const unsigned kMailboxFresh = 4;  // flag on `middle`: written since the reader last took it
+
+FrameMailbox::~FrameMailbox() {
+    frame_mailbox_clear(this);
+}
+
+void frame_mailbox_put(FrameMailbox* mb, GstSample* sample) {
+    MailboxFrame& f = mb->slots[mb->back];
+    f.sample = sample;
+    f.arrival_us = g_get_monotonic_time();
+    const unsigned prev = mb->middle.exchange(mb->back | kMailboxFresh, std::memory_order_acq_rel);
+    mb->back = prev & ~kMailboxFresh;
+    mb->written.fetch_add(1, std::memory_order_relaxed);
+    if (prev & kMailboxFresh) {
+        mb->dropped.fetch_add(1, std::memory_order_relaxed);
+        if (mb->metrics) mb->metrics->mailbox_dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Either a frame that was never taken or one the reader has moved past
+    MailboxFrame& old = mb->slots[mb->back];
+    if (old.sample) {
+        gst_sample_unref(old.sample);
+        old.sample = nullptr;
+    }
+}
+
+const MailboxFrame* frame_mailbox_take(FrameMailbox* mb) {
+    // Only the writer sets the flag, so it is still set at the exchange
+    if (!(mb->middle.load(std::memory_order_acquire) & kMailboxFresh)) return nullptr;
+    mb->front = mb->middle.exchange(mb->front, std::memory_order_acq_rel) & ~kMailboxFresh;
+    return &mb->slots[mb->front];
+}
+
+const MailboxFrame* frame_mailbox_current(const FrameMailbox* mb) {
+    return &mb->slots[mb->front];
+}
+
+void frame_mailbox_clear(FrameMailbox* mb) {
+    for (MailboxFrame& f : mb->slots) {
+        if (f.sample) gst_sample_unref(f.sample);
+        f.sample = nullptr;
+    }
+}
+
+static GstFlowReturn on_new_sample(GstElement* sink, gpointer user_data) {
+    GstSample* sample = nullptr;
+    g_signal_emit_by_name(sink, "pull-sample", &sample);
+    if (!sample) return GST_FLOW_EOS;  // flushing or EOS
+    frame_mailbox_put(static_cast<FrameMailbox*>(user_data), sample);
+    return GST_FLOW_OK;
+}
+
+static GstElement* make_appsink(FrameMailbox* mb, const std::string& name, GstCaps* caps) {
+    GstElement* sink = gst_element_factory_make("appsink", name.c_str());
+    if (!sink) return nullptr;
+    mb->name = name;
+    // Through signals rather than gst_app_sink_*: no gstreamer-app library to link
+    g_object_set(G_OBJECT(sink),
+        "caps", caps,
+        "emit-signals", TRUE,
+        "sync", FALSE,
+        "max-buffers", 1,
+        "drop", TRUE,
+        NULL);
+    g_signal_connect(sink, "new-sample", G_CALLBACK(on_new_sample), mb);
+    return sink;
+}
+
+GstElement* frame_mailbox_sink(FrameMailbox* mb, const std::string& name) {
+    GstCaps* caps = gst_caps_new_simple("video/x-raw", "format", G_TYPE_STRING, "BGRx", NULL);
+    GstElement* sink = make_appsink(mb, name, caps);
+    gst_caps_unref(caps);
+    return sink;
+}
+
+GstElement* frame_mailbox_tile_sink(FrameMailbox* mb, const std::string& name, GstCaps* caps) {
+    GstElement* bin = gst_bin_new(name.c_str());
+    GstElement* conv = gst_element_factory_make("videoconvert", (name + "_conv").c_str());
+    GstElement* scale = gst_element_factory_make("videoscale", (name + "_scale").c_str());
+    GstElement* sink = make_appsink(mb, name + "_appsink", caps);
+    if (!conv || !scale || !sink) {
+        for (GstElement* e : {conv, scale, sink}) {
+            if (e) gst_object_unref(e);
+        }
+        gst_object_unref(bin);
+        return nullptr;
+    }
+    mb->name = name;
+    gst_bin_add_many(GST_BIN(bin), conv, scale, sink, NULL);
+    gst_element_link_many(conv, scale, sink, NULL);
+    convert_chain_count_copies(conv, mb->metrics);
+    convert_chain_count_copies(scale, mb->metrics);
+    GstPad* pad = gst_element_get_static_pad(conv, "sink");
+    gst_element_add_pad(bin, gst_ghost_pad_new("sink", pad));
+    gst_object_unref(pad);
+    return bin;
+}
+
+GstElement* frame_mailbox_tile_sink(FrameMailbox* mb, const std::string& name, int width, int height) {
+    GstCaps* caps = gst_caps_new_simple("video/x-raw",
+        "format", G_TYPE_STRING, "BGRx",
+        "width", G_TYPE_INT, width,
+        "height", G_TYPE_INT, height,
+        NULL);
+    GstElement* bin = frame_mailbox_tile_sink(mb, name, caps);
+    gst_caps_unref(caps);
+    return bin;
+}
@@ -0,0 +1,63 @@
+// frame_mailbox.h
+// Newest-frame mailbox between a camera's streaming thread and a render loop.
+//
+// A sink per tile redraws whenever its camera delivers, so N cameras with sync=false turn N
+// independent jitters into N uneven redraws. Here the pipeline ends in an appsink whose frames go
+// into a triple buffer: the streaming thread writes the back slot and swaps it with the middle
+// one, the render loop (one per window, at display refresh) swaps the middle slot with its front
+// slot when a newer frame is there. Both sides only do an atomic exchange: nothing blocks, no
+// frame is copied, and a frame the render loop never took is simply replaced (counted as dropped).
+//
+// The front slot stays with the render loop until it takes a newer frame, so a tile keeps its last
+// picture during a reconnect. At most two frames per tile are held (middle and front); the one the
+// writer gets back is released on the streaming thread, returning its buffer to the decoder pool.
+#pragma once
+
+#include <gst/gst.h>
+
+#include <atomic>
+#include <string>
+
+struct StreamMetrics;
+
+struct MailboxFrame {
+    GstSample* sample {nullptr};
+    gint64 arrival_us {0};  // g_get_monotonic_time() when the appsink handed it over
+};
+
+struct FrameMailbox {
+    std::string name;
+    StreamMetrics* metrics {nullptr};  // mailbox_dropped (optional)
+
+    MailboxFrame slots[3];
+    unsigned back {0};                 // writer only
+    std::atomic<unsigned> middle {1};  // slot index, | kMailboxFresh when not taken yet
+    unsigned front {2};                // reader only
+
+    std::atomic<guint64> written {0};
+    std::atomic<guint64> dropped {0};  // replaced before the render loop took them
+
+    ~FrameMailbox();
+};
+
+// Creates the tile's sink: appsink with BGRx caps (cairo's RGB24 layout), sync=false, feeding `mb`.
+// The caller puts a videoconvert (or a decoder that outputs BGRx) in front of it.
+GstElement* frame_mailbox_sink(FrameMailbox* mb, const std::string& name);
+// The same behind videoconvert ! videoscale to `width` x `height`, as one bin with a "sink" pad,
+// for chains that end at the decoder (the sink it replaces converted and scaled by itself).
+GstElement* frame_mailbox_tile_sink(FrameMailbox* mb, const std::string& name, int width, int height);
+// videoconvert ! videoscale ! appsink accepting `caps` (ownership stays with the caller). The two
+// converters stay in passthrough when the decoder's output already matches: every frame one of them
+// does touch is counted in metrics frame_copies (convert stage).
+GstElement* frame_mailbox_tile_sink(FrameMailbox* mb, const std::string& name, GstCaps* caps);
+
+// Writer side (streaming thread): takes the caller's reference.
+void frame_mailbox_put(FrameMailbox* mb, GstSample* sample);
+
+// Reader side (render loop): the newest frame if one arrived since the last take, else null.
+const MailboxFrame* frame_mailbox_take(FrameMailbox* mb);
+// Reader side: the frame taken last (sample null before the first one).
+const MailboxFrame* frame_mailbox_current(const FrameMailbox* mb);
+
+// Drops every held frame; the pipeline must be stopped.
+void frame_mailbox_clear(FrameMailbox* mb);
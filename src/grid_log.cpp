@@ -0,0 +1,328 @@
+// grid_log.cpp
+#include "grid_log.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+static const size_t kRingSize = 1024;    // entries per stream, power of two
+static const size_t kTextMax = 300;
+static const int kMaxStreams = 64;
+static const int kKeepFiles = 3;
+
+struct LogEntry {
+    std::atomic<size_t> seq {0};
+    gint64 wall_us {0};
+    LogLevel level {LogLevel::Info};
+    uint16_t len {0};
+    char text[kTextMax];
+};
+
+// Bounded multi-producer ring (per-slot sequence numbers): a producer claims a slot with one CAS
+// on `tail`, fills it and publishes it by bumping the slot's sequence; only the single consumer
+// (the flusher) advances `head`.
+struct LogStream {
+    std::string name;
+    LogEntry ring[kRingSize];
+    alignas(64) std::atomic<size_t> tail {0};
+    alignas(64) std::atomic<size_t> head {0};
+    std::atomic<uint64_t> dropped {0};
+
+    // Flusher-only state
+    uint64_t dropped_reported {0};
+    FILE* file {nullptr};
+    std::string path;
+    long long file_bytes {0};
+
+    LogStream() {
+        for (size_t i = 0; i < kRingSize; ++i) ring[i].seq.store(i, std::memory_order_relaxed);
+    }
+};
+
+struct LogState {
+    std::unique_ptr<LogStream> streams[kMaxStreams];
+    std::atomic<int> count {0};
+    std::mutex register_mutex;
+
+    std::string dir;
+    bool console {false};
+    long long max_bytes {10LL * 1024 * 1024};
+
+    std::thread flusher;
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    std::atomic<bool> running {false};
+    std::atomic<bool> kick {false};
+    bool stop {false};
+
+    GPrintFunc old_print {nullptr};
+    GPrintFunc old_printerr {nullptr};
+};
+
+static LogState g_log;
+
+static void wake_flusher() {
+    g_log.kick.store(true, std::memory_order_relaxed);
+    g_log.wake.notify_one();
+}
+
+// ---- Producers ----
+
+void grid_log_write(LogStream* s, LogLevel level, const char* text, size_t len) {
+    if (!s) return;
+    size_t pos = s->tail.load(std::memory_order_relaxed);
+    LogEntry* e = nullptr;
+    for (;;) {
+        e = &s->ring[pos & (kRingSize - 1)];
+        size_t seq = e->seq.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (s->tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            s->dropped.fetch_add(1, std::memory_order_relaxed);  // full: drop, never wait
+            return;
+        } else {
+            pos = s->tail.load(std::memory_order_relaxed);
+        }
+    }
+
+    e->wall_us = g_get_real_time();
+    e->level = level;
+    if (len > kTextMax - 1) {
+        len = kTextMax - 1;
+        std::memcpy(e->text, text, len - 3);
+        std::memcpy(e->text + len - 3, "...", 3);
+    } else {
+        std::memcpy(e->text, text, len);
+    }
+    if (len == 0 || e->text[len - 1] != '\n') e->text[len++] = '\n';
+    e->len = (uint16_t)len;
+    e->seq.store(pos + 1, std::memory_order_release);
+
+    // Half full: flush now instead of at the next 50 ms tick (a futex wake, no I/O)
+    if (pos + 1 - s->head.load(std::memory_order_relaxed) == kRingSize / 2) wake_flusher();
+}
+
+void grid_log(LogStream* s, LogLevel level, const char* fmt, ...) {
+    char buf[kTextMax];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = std::vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    grid_log_write(s, level, buf, (size_t)n < sizeof(buf) ? (size_t)n : sizeof(buf) - 1);
+}
+
+LogStream* grid_log_stream(const std::string& name) {
+    int n = g_log.count.load(std::memory_order_acquire);
+    for (int i = 0; i < n; ++i) {
+        if (g_log.streams[i]->name == name) return g_log.streams[i].get();
+    }
+    std::lock_guard<std::mutex> lock(g_log.register_mutex);
+    n = g_log.count.load(std::memory_order_relaxed);
+    for (int i = 0; i < n; ++i) {
+        if (g_log.streams[i]->name == name) return g_log.streams[i].get();
+    }
+    if (n == kMaxStreams) return g_log.streams[0].get();  // "main"
+    g_log.streams[n].reset(new LogStream());
+    g_log.streams[n]->name = name;
+    g_log.count.store(n + 1, std::memory_order_release);
+    return g_log.streams[n].get();
+}
+
+// "[cam2] ..." -> stream "cam2" without allocating once the stream exists.
+static LogStream* stream_for_prefix(const char* text) {
+    if (text[0] == '[') {
+        const char* end = std::strchr(text, ']');
+        if (end && end - text > 1 && end - text < 48) {
+            size_t len = (size_t)(end - text - 1);
+            int n = g_log.count.load(std::memory_order_acquire);
+            for (int i = 0; i < n; ++i) {
+                const std::string& nm = g_log.streams[i]->name;
+                if (nm.size() == len && std::memcmp(nm.data(), text + 1, len) == 0) return g_log.streams[i].get();
+            }
+            return grid_log_stream(std::string(text + 1, len));
+        }
+    }
+    return grid_log_stream("main");
+}
+
+static void on_print(const gchar* text) {
+    grid_log_write(stream_for_prefix(text), LogLevel::Info, text, std::strlen(text));
+}
+
+static void on_printerr(const gchar* text) {
+    grid_log_write(stream_for_prefix(text), LogLevel::Warn, text, std::strlen(text));
+}
+
+uint64_t grid_log_dropped() {
+    uint64_t total = 0;
+    int n = g_log.count.load(std::memory_order_acquire);
+    for (int i = 0; i < n; ++i) total += g_log.streams[i]->dropped.load(std::memory_order_relaxed);
+    return total;
+}
+
+// ---- Flusher ----
+
+static const char* level_name(LogLevel l) {
+    switch (l) {
+    case LogLevel::Warn: return "WARN";
+    case LogLevel::Error: return "ERROR";
+    default: return "INFO";
+    }
+}
+
+// "2025-01-31 12:00:00" is rebuilt only when the second changes.
+struct TimestampCache {
+    gint64 sec {-1};
+    char prefix[32] {};
+};
+
+static void format_time(TimestampCache& tc, gint64 wall_us, char out[40]) {
+    gint64 sec = wall_us / G_USEC_PER_SEC;
+    if (sec != tc.sec) {
+        GDateTime* dt = g_date_time_new_from_unix_local(sec);
+        gchar* s = dt ? g_date_time_format(dt, "%Y-%m-%d %H:%M:%S") : nullptr;
+        g_strlcpy(tc.prefix, s ? s : "", sizeof(tc.prefix));
+        g_free(s);
+        if (dt) g_date_time_unref(dt);
+        tc.sec = sec;
+    }
+    std::snprintf(out, 40, "%s.%03d", tc.prefix, (int)((wall_us / 1000) % 1000));
+}
+
+static void open_file(LogStream* s) {
+    if (s->file || g_log.dir.empty()) return;
+    std::string leaf = s->name;
+    for (char& c : leaf) if (c == '/' || c == '\\' || c == ':') c = '_';
+    s->path = g_log.dir + G_DIR_SEPARATOR_S + leaf + ".log";
+    s->file = g_fopen(s->path.c_str(), "ab");
+    if (!s->file) return;
+    std::fseek(s->file, 0, SEEK_END);
+    s->file_bytes = std::ftell(s->file);
+}
+
+// cam1.log -> cam1.log.1 -> ... -> cam1.log.3 (dropped)
+static void rotate(LogStream* s) {
+    std::fclose(s->file);
+    s->file = nullptr;
+    for (int i = kKeepFiles; i >= 1; --i) {
+        std::string from = i == 1 ? s->path : s->path + "." + std::to_string(i - 1);
+        std::string to = s->path + "." + std::to_string(i);
+        g_remove(to.c_str());
+        g_rename(from.c_str(), to.c_str());
+    }
+    open_file(s);
+}
+
+static void drain(LogStream* s, TimestampCache& tc) {
+    bool wrote = false;
+    uint64_t dropped = s->dropped.load(std::memory_order_relaxed);
+    if (dropped != s->dropped_reported) {
+        char buf[128];
+        int n = std::snprintf(buf, sizeof(buf), "[%s] %llu log messages dropped (ring full)\n",
+                              s->name.c_str(), (unsigned long long)(dropped - s->dropped_reported));
+        s->dropped_reported = dropped;
+        if (n >= (int)sizeof(buf)) n = (int)sizeof(buf) - 1;
+        if (g_log.console) std::fwrite(buf, 1, (size_t)n, stderr);
+        open_file(s);
+        if (s->file) { std::fwrite(buf, 1, (size_t)n, s->file); s->file_bytes += n; wrote = true; }
+    }
+
+    size_t head = s->head.load(std::memory_order_relaxed);
+    for (;;) {
+        LogEntry& e = s->ring[head & (kRingSize - 1)];
+        if (e.seq.load(std::memory_order_acquire) != head + 1) break;
+
+        if (g_log.console) std::fwrite(e.text, 1, e.len, e.level == LogLevel::Info ? stdout : stderr);
+        open_file(s);
+        if (s->file) {
+            char ts[40];
+            format_time(tc, e.wall_us, ts);
+            int n = std::fprintf(s->file, "%s [%s] ", ts, level_name(e.level));
+            std::fwrite(e.text, 1, e.len, s->file);
+            s->file_bytes += n + e.len;
+            wrote = true;
+        }
+
+        e.seq.store(head + kRingSize, std::memory_order_release);
+        s->head.store(++head, std::memory_order_relaxed);
+    }
+
+    if (wrote && s->file) {
+        std::fflush(s->file);
+        if (s->file_bytes > g_log.max_bytes) rotate(s);
+    }
+}
+
+static void drain_all(TimestampCache& tc) {
+    int n = g_log.count.load(std::memory_order_acquire);
+    for (int i = 0; i < n; ++i) drain(g_log.streams[i].get(), tc);
+    if (g_log.console) {
+        std::fflush(stdout);
+        std::fflush(stderr);
+    }
+}
+
+static void flusher_loop() {
+    TimestampCache tc;
+    for (;;) {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(g_log.wake_mutex);
+            g_log.wake.wait_for(lock, std::chrono::milliseconds(50), [] { return g_log.stop || g_log.kick.exchange(false); });
+            stopping = g_log.stop;
+        }
+        drain_all(tc);
+        if (stopping) break;
+    }
+    int n = g_log.count.load(std::memory_order_acquire);
+    for (int i = 0; i < n; ++i) {
+        LogStream* s = g_log.streams[i].get();
+        if (s->file) { std::fclose(s->file); s->file = nullptr; }
+    }
+}
+
+void grid_log_start(const std::string& dir, bool console) {
+    static bool at_exit = false;
+    if (g_log.running.exchange(true)) return;
+    if (!at_exit) {
+        std::atexit(grid_log_stop);
+        at_exit = true;
+    }
+    g_log.dir = dir;
+    const char* env_dir = std::getenv("GRID_LOG_DIR");
+    if (g_log.dir.empty() && env_dir) g_log.dir = env_dir;
+    g_log.console = console;
+    const char* env = std::getenv("GRID_LOG_MAX_MB");
+    if (env && std::atoi(env) > 0) g_log.max_bytes = std::atoll(env) * 1024 * 1024;
+    if (!g_log.dir.empty()) g_mkdir_with_parents(g_log.dir.c_str(), 0755);  // also $GRID_LOG_DIR
+
+    grid_log_stream("main");
+    g_log.stop = false;
+    g_log.flusher = std::thread(flusher_loop);
+    g_log.old_print = g_set_print_handler(on_print);
+    g_log.old_printerr = g_set_printerr_handler(on_printerr);
+}
+
+void grid_log_stop() {
+    if (!g_log.running.exchange(false)) return;
+    g_set_print_handler(g_log.old_print);
+    g_set_printerr_handler(g_log.old_printerr);
+    {
+        std::lock_guard<std::mutex> lock(g_log.wake_mutex);
+        g_log.stop = true;
+    }
+    g_log.wake.notify_one();
+    if (g_log.flusher.joinable()) g_log.flusher.join();
+}
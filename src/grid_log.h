@@ -0,0 +1,45 @@
+// grid_log.h
+// Asynchronous logging shared by every entry point.
+//
+// Each stream ("cam1", "bench", ...) owns a bounded lock-free ring of fixed-size entries. Callers
+// (bus threads, streaming threads, pad-added handlers) format the message into a free slot and
+// return; they never take a lock, allocate or touch a file. One flusher thread drains the rings
+// every 50 ms, prefixes a timestamp (the date/time part is formatted once per second) and writes
+// to the console and/or <dir>/<stream>.log with size-based rotation. When a ring is full the
+// message is dropped and counted instead of blocking; the count is logged on the next flush.
+//
+// grid_log_start() also routes g_print()/g_printerr() through the rings: a message starting with
+// "[name]" goes to that stream, anything else to "main".
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+enum class LogLevel { Info, Warn, Error };
+
+struct LogStream;
+
+// `dir`: per-stream log files in this directory (created if needed); empty = $GRID_LOG_DIR, or
+// no files when that is unset too.
+// `console`: also print to stdout (Info) / stderr (Warn, Error) like g_print/g_printerr did.
+// File size limit from $GRID_LOG_MAX_MB (default 10); <stream>.log.1 .. .3 keep the older output.
+void grid_log_start(const std::string& dir, bool console);
+
+// Drains everything still queued, stops the flusher and gives g_print/g_printerr back. Also runs
+// at exit.
+void grid_log_stop();
+
+// Stream by name, registered on first use (up to 64 streams; later ones share "main").
+LogStream* grid_log_stream(const std::string& name);
+
+// Never blocks. The text is cut at about 300 bytes; a trailing newline is added when missing.
+void grid_log_write(LogStream* s, LogLevel level, const char* text, size_t len);
+void grid_log(LogStream* s, LogLevel level, const char* fmt, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 3, 4)))
+#endif
+    ;
+
+// Messages dropped because a ring was full, over all streams since start.
+uint64_t grid_log_dropped();
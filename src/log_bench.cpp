@@ -0,0 +1,120 @@
+// log_bench.cpp
+// Logging microbenchmark: N threads log a burst of RTP-warning-like lines, one stream per thread
+// (as the cameras do). Prints messages/s and the p50/p99/max latency of a single log call.
+//
+//   grid_log_bench [threads] [messages per thread] [--legacy]
+//
+// Default is grid_log (ring buffers + flusher thread). --legacy measures the previous Windows
+// Logger: mutex, open the file in append mode, ostringstream timestamp, close, per line.
+#include <glib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "grid_log.h"
+
+using Clock = std::chrono::steady_clock;
+
+class LegacyLogger {
+public:
+    explicit LegacyLogger(const std::string& path) : path_(path) {}
+
+    void log(const std::string& level, const std::string& msg) {
+        std::lock_guard<std::mutex> lock(mu_);
+        std::ofstream ofs(path_, std::ios::app);
+        ofs << timestamp() << " [" << level << "] " << msg << "\n";
+    }
+
+private:
+    static std::string timestamp() {
+        using namespace std::chrono;
+        auto now = system_clock::now();
+        std::time_t t = system_clock::to_time_t(now);
+        std::tm tm = *std::localtime(&t);
+        auto ms = duration_cast<milliseconds>(now.time_since_epoch()) % 1000;
+        std::ostringstream oss;
+        oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S") << '.' << std::setw(3) << std::setfill('0') << ms.count();
+        return oss.str();
+    }
+
+    std::mutex mu_;
+    std::string path_;
+};
+
+int main(int argc, char** argv) {
+    int threads = 4;
+    int per_thread = 100000;
+    bool legacy = false;
+    int pos = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--legacy") == 0) legacy = true;
+        else if (pos++ == 0) threads = std::max(1, std::atoi(argv[i]));
+        else per_thread = std::max(1, std::atoi(argv[i]));
+    }
+
+    gchar* dir = g_build_filename(g_get_tmp_dir(), "grid_log_bench", NULL);
+    g_mkdir_with_parents(dir, 0755);
+    if (!legacy) grid_log_start(dir, false);
+
+    std::vector<std::vector<uint32_t>> lat(threads);
+    std::vector<std::thread> workers;
+    Clock::time_point start = Clock::now();
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::string name = "bench" + std::to_string(t + 1);
+            LogStream* s = legacy ? nullptr : grid_log_stream(name);
+            gchar* path = g_build_filename(dir, (name + "-legacy.log").c_str(), NULL);
+            LegacyLogger ll(path);
+            g_free(path);
+            std::vector<uint32_t>& v = lat[t];
+            v.reserve(per_thread);
+            for (int i = 0; i < per_thread; ++i) {
+                Clock::time_point a = Clock::now();
+                if (legacy) {
+                    ll.log("WARN", "Warning: Could not decode stream. | debug: gstrtpjitterbuffer.c: Packet #" +
+                                   std::to_string(i) + " lost");
+                } else {
+                    grid_log(s, LogLevel::Warn, "Warning: Could not decode stream. | debug: gstrtpjitterbuffer.c: "
+                             "Packet #%d lost", i);
+                }
+                v.push_back((uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - a).count());
+            }
+        });
+    }
+    for (std::thread& w : workers) w.join();
+    double produce_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    uint64_t dropped = legacy ? 0 : grid_log_dropped();
+    Clock::time_point drain_start = Clock::now();
+    if (!legacy) grid_log_stop();
+    double drain_ms = std::chrono::duration<double, std::milli>(Clock::now() - drain_start).count();
+
+    std::vector<uint32_t> all;
+    for (const std::vector<uint32_t>& v : lat) all.insert(all.end(), v.begin(), v.end());
+    std::sort(all.begin(), all.end());
+    auto pct = [&](double p) { return all[std::min(all.size() - 1, (size_t)(p * all.size()))] / 1000.0; };
+    uint64_t total = (uint64_t)threads * per_thread;
+
+    std::printf("%s: %d threads x %d messages, files in %s\n",
+                legacy ? "legacy ofstream" : "grid_log", threads, per_thread, dir);
+    std::printf("  %.0f messages/s (%.3f s)\n", total / produce_s, produce_s);
+    std::printf("  log call latency: p50 %.2f us, p99 %.2f us, max %.2f us\n", pct(0.50), pct(0.99),
+                all.back() / 1000.0);
+    if (!legacy) {
+        std::printf("  dropped (ring full): %llu of %llu, final drain %.1f ms\n",
+                    (unsigned long long)dropped, (unsigned long long)total, drain_ms);
+    }
+    g_free(dir);
+    return 0;
+}
@@ -0,0 +1,571 @@
+// main_bench.cpp
+// Headless throughput benchmark: N synthetic cameras served in-process (fake_camera), received
+// and decoded by the same rtspsrc + decode chain code as the viewers, into fakesink sync=false.
+// Needs no cameras, display or network (everything is on 127.0.0.1), so it runs on a CI box.
+//
+//   gstreamer_demo_bench [--streams N] [--codec h264|h265] [--size WxH] [--fps F] [--gop G]
+//                        [--bitrate KBPS] [--seconds S] [--warmup S] [--port P] [--udp]
+//                        [--software] [--no-baseline] [--startup] [--mosaic] [--mosaic-stall]
+//                        [--min-fps F] [fake camera impairments]
+//
+// Two phases on the same server: first every stream is only received (rtspsrc ! fakesink), then
+// received and decoded. The encoders run in this process too, so the CPU of the decode chain per
+// stream is the difference of the two phases divided by N. Exit code 1 if a stream posted an
+// error or decoded nothing.
+//
+// --startup measures bring-up and exit instead: the time until every stream decoded its first
+// frame, and the time to stop them all, once one camera after another (set_state on this thread,
+// as the viewers used to) and once through startup.h (PLAYING and NULL on pools, all at once).
+// Run it with --streams 4, 16 and 32 for the scaling curve.
+//
+// --mosaic compares the two ways the Pi viewers show the grid: one pipeline per camera (the decode
+// phase above) against the single-pipeline mosaic (mosaic.h: every tile into one compositor, the
+// wall into fakesink), CPU, memory and tile latency side by side.
+//
+// --mosaic-stall runs the mosaic only and freezes cam1 (fake_camera_stall) for the measured part:
+// the session stays up but no frame arrives, so its tile misses the deadline and is rebuilt over
+// and over. Prints the fps of every tile; exit code 1 if any other tile fell below --min-fps
+// (default 80% of --fps) or was rebuilt, i.e. the stall was not isolated to its own tile.
+#include <gst/gst.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "codec_chain.h"
+#include "decoder_bench.h"
+#include "fake_camera.h"
+#include "grid_log.h"
+#include "metrics.h"
+#include "mosaic.h"
+#include "startup.h"
+#include "stream_set.h"
+#ifdef __linux__
+#include "proc_stats.h"
+#endif
+
+struct BenchOptions {
+    FakeCameraOptions server;
+    int seconds {10};
+    int warmup {3};
+    bool udp {false};
+    bool software {false};
+    bool baseline {true};
+    bool startup {false};
+    bool mosaic {false};
+    bool mosaic_stall {false};
+    double min_fps {0.0};  // 0: 80% of the camera rate
+};
+
+struct BenchStream {
+    std::string name;
+    std::string url;
+    bool decode {true};
+
+    GstElement* pipeline {nullptr};
+    GstElement* src {nullptr};
+    GstElement* sink {nullptr};
+    DecodeChain dc;
+    StreamMetrics metrics;
+    guint watch_id {0};
+    int errors {0};
+};
+
+struct StreamResult {
+    std::string decoder;
+    double fps {0.0};
+    double mbps {0.0};
+    LatencyHistogram latency;
+    int errors {0};  // mosaic: tile rebuilds
+};
+
+struct PhaseResult {
+    bool have_cpu {false};
+    double cpu_pct {0.0};  // 100% = one core
+    long rss_kb {0};
+    int threads {0};
+    std::vector<StreamResult> streams;
+};
+
+static void on_src_pad_added(GstElement* /*src*/, GstPad* pad, gpointer user_data) {
+    BenchStream* s = static_cast<BenchStream*>(user_data);
+    if (s->decode) {
+        decode_chain_link_pad(&s->dc, GST_BIN(s->pipeline), pad, s->sink);
+        return;
+    }
+    GstPad* sinkpad = gst_element_get_static_pad(s->sink, "sink");
+    if (!gst_pad_is_linked(sinkpad) && gst_pad_link(pad, sinkpad) == GST_PAD_LINK_OK) {
+        stream_metrics_watch_ingress(&s->metrics, pad);
+    }
+    gst_object_unref(sinkpad);
+}
+
+static gboolean on_bus_msg(GstBus* /*bus*/, GstMessage* msg, gpointer user_data) {
+    BenchStream* s = static_cast<BenchStream*>(user_data);
+    switch (GST_MESSAGE_TYPE(msg)) {
+    case GST_MESSAGE_ERROR: {
+        GError* err = nullptr; gchar* dbg = nullptr;
+        gst_message_parse_error(msg, &err, &dbg);
+        g_printerr("[%s][ERROR] %s | %s\n", s->name.c_str(), err?err->message:"", dbg?dbg:"");
+        if (err) g_error_free(err); if (dbg) g_free(dbg);
+        ++s->errors;
+        break;
+    }
+    case GST_MESSAGE_EOS:
+        g_printerr("[%s] EOS\n", s->name.c_str());
+        ++s->errors;
+        break;
+    case GST_MESSAGE_QOS:
+        stream_metrics_qos(&s->metrics);
+        break;
+    default: break;
+    }
+    return TRUE;
+}
+
+// `async`: PLAYING through startup_play_async() instead of on this thread.
+static bool build_stream(BenchStream* s, const BenchOptions& o, bool async = false) {
+    s->pipeline = gst_pipeline_new((s->name + "_pipe").c_str());
+    s->src      = gst_element_factory_make("rtspsrc", (s->name + "_src").c_str());
+    s->sink     = gst_element_factory_make("fakesink", (s->name + "_sink").c_str());
+    if (!s->pipeline || !s->src || !s->sink) {
+        g_printerr("[%s] Failed to create core elements\n", s->name.c_str());
+        return false;
+    }
+    g_object_set(G_OBJECT(s->src),
+        "location", s->url.c_str(),
+        "latency", 0,
+        "protocols", o.udp ? 1 /* UDP */ : 4 /* TCP */,
+        NULL);
+    g_object_set(G_OBJECT(s->sink), "sync", FALSE, "async", FALSE, NULL);
+
+    gst_bin_add_many(GST_BIN(s->pipeline), s->src, s->sink, NULL);
+    if (s->decode) {
+        s->dc.metrics = &s->metrics;
+        decode_chain_prebuild(&s->dc, GST_BIN(s->pipeline), s->sink);
+        stream_metrics_watch_sink(&s->metrics, s->sink);
+    }
+    g_signal_connect(s->src, "pad-added", G_CALLBACK(on_src_pad_added), s);
+
+    GstBus* bus = gst_element_get_bus(s->pipeline);
+    s->watch_id = gst_bus_add_watch(bus, on_bus_msg, s);
+    gst_object_unref(bus);
+
+    if (async) {
+        startup_play_async(s->pipeline, nullptr, nullptr);
+        return true;
+    }
+    if (gst_element_set_state(s->pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        g_printerr("[%s] Failed to set PLAYING\n", s->name.c_str());
+        return false;
+    }
+    return true;
+}
+
+static void destroy_stream(BenchStream* s) {
+    if (s->watch_id) g_source_remove(s->watch_id);
+    s->watch_id = 0;
+    if (s->pipeline) {
+        gst_element_set_state(s->pipeline, GST_STATE_NULL);
+        gst_object_unref(s->pipeline);
+    }
+    decode_chain_reset(&s->dc);
+    s->pipeline = s->src = s->sink = nullptr;
+}
+
+static gboolean quit_cb(gpointer user_data) {
+    g_main_loop_quit(static_cast<GMainLoop*>(user_data));
+    return G_SOURCE_REMOVE;
+}
+
+static void run_for(GMainLoop* loop, int seconds) {
+    g_timeout_add_seconds((guint)std::max(1, seconds), quit_cb, loop);
+    g_main_loop_run(loop);
+}
+
+struct Snapshot {
+    guint64 decoded {0};
+    guint64 displayed {0};
+    guint64 bytes {0};
+    guint64 reconnects {0};
+    LatencyHistogram latency;
+};
+
+static Snapshot snapshot(const StreamMetrics& m) {
+    Snapshot snap;
+    snap.decoded = m.decoded_frames.load();
+    snap.displayed = m.displayed_frames.load();
+    snap.bytes = m.ingress_bytes.load();
+    snap.reconnects = m.reconnects.load();
+    stream_metrics_latency(&m, snap.latency);
+    return snap;
+}
+
+static void latency_delta(const Snapshot& before, const Snapshot& after, LatencyHistogram& out) {
+    out.total = after.latency.total - before.latency.total;
+    for (int b = 0; b <= kLatencyBuckets; ++b) out.counts[b] = after.latency.counts[b] - before.latency.counts[b];
+}
+
+#ifdef __linux__
+static void cpu_delta(const ProcSample& p0, const ProcSample& p1, PhaseResult& out) {
+    if (p1.wall_s <= p0.wall_s) return;
+    out.have_cpu = true;
+    out.cpu_pct = 100.0 * (p1.cpu_s - p0.cpu_s) / (p1.wall_s - p0.wall_s);
+    out.rss_kb = p1.rss_kb;
+    out.threads = p1.threads;
+}
+#endif
+
+// Builds every stream, runs `warmup` seconds, then measures for `seconds`.
+static bool run_phase(const BenchOptions& o, const std::vector<std::string>& urls, bool decode, GMainLoop* loop,
+                      PhaseResult& out) {
+    std::vector<std::unique_ptr<BenchStream>> streams;
+    bool ok = true;
+    for (size_t i = 0; i < urls.size(); ++i) {
+        auto s = std::make_unique<BenchStream>();
+        s->name = "cam" + std::to_string(i + 1);
+        s->url = urls[i];
+        s->decode = decode;
+        decode_chain_init(&s->dc, s->name, s->url, o.software);
+        stream_metrics_init(&s->metrics, s->name);
+        if (!build_stream(s.get(), o)) ok = false;
+        streams.push_back(std::move(s));
+    }
+
+    if (ok) {
+        run_for(loop, o.warmup);
+        std::vector<Snapshot> before;
+        for (auto& s : streams) before.push_back(snapshot(s->metrics));
+#ifdef __linux__
+        ProcSample p0, p1;
+        proc_sample(p0);
+#endif
+        gint64 t0 = g_get_monotonic_time();
+        run_for(loop, o.seconds);
+        double dt = (g_get_monotonic_time() - t0) / 1e6;
+#ifdef __linux__
+        if (proc_sample(p1)) cpu_delta(p0, p1, out);
+#endif
+        for (size_t i = 0; i < streams.size(); ++i) {
+            const BenchStream& s = *streams[i];
+            Snapshot after = snapshot(s.metrics);
+            StreamResult r;
+            r.decoder = s.decode ? s.dc.chain.decoder : std::string("-");
+            r.fps = s.decode ? (after.decoded - before[i].decoded) / dt : 0.0;
+            r.mbps = (after.bytes - before[i].bytes) * 8.0 / dt / 1e6;
+            latency_delta(before[i], after, r.latency);
+            r.errors = s.errors;
+            out.streams.push_back(r);
+        }
+    }
+    for (auto& s : streams) destroy_stream(s.get());
+    return ok;
+}
+
+// The same cameras as one mosaic into fakesink, the wall at the camera size. `stall` >= 0: that
+// camera is frozen for the measured part. Tile fps is counted where the tile enters the mixer.
+static bool run_mosaic_phase(const BenchOptions& o, FakeCameraServer* server, int stall, GMainLoop* loop,
+                             PhaseResult& out) {
+    std::vector<CameraConfig> cams;
+    for (size_t i = 0; i < server->urls.size(); ++i) {
+        CameraConfig c;
+        c.name = "cam" + std::to_string(i + 1);
+        c.url = server->urls[i];
+        cams.push_back(c);
+    }
+    Mosaic m;
+    GstElement* sink = gst_element_factory_make("fakesink", "mosaic_sink");
+    bool ok = mosaic_build(&m, cams, grid_layout_for(cams.size()), o.server.width, o.server.height, false, sink) &&
+              mosaic_start(&m);
+
+    if (ok) {
+        run_for(loop, o.warmup);
+        if (stall >= 0) {
+            g_print("[bench] Stalling cam%d\n", stall + 1);
+            fake_camera_stall(server, stall, true);
+        }
+        std::vector<Snapshot> before;
+        for (auto& t : m.tiles) before.push_back(snapshot(t->metrics));
+#ifdef __linux__
+        ProcSample p0, p1;
+        proc_sample(p0);
+#endif
+        gint64 t0 = g_get_monotonic_time();
+        run_for(loop, o.seconds);
+        double dt = (g_get_monotonic_time() - t0) / 1e6;
+#ifdef __linux__
+        if (proc_sample(p1)) cpu_delta(p0, p1, out);
+#endif
+        for (size_t i = 0; i < m.tiles.size(); ++i) {
+            const MosaicTile& t = *m.tiles[i];
+            Snapshot after = snapshot(t.metrics);
+            StreamResult r;
+            r.decoder = t.dc.chain.decoder;
+            r.fps = (after.displayed - before[i].displayed) / dt;
+            r.mbps = (after.bytes - before[i].bytes) * 8.0 / dt / 1e6;
+            latency_delta(before[i], after, r.latency);
+            r.errors = (int)(after.reconnects - before[i].reconnects);
+            out.streams.push_back(r);
+        }
+        if (stall >= 0) fake_camera_stall(server, stall, false);
+    }
+    mosaic_cleanup(&m);
+    return ok;
+}
+
+static LatencyHistogram merged_latency(const PhaseResult& p) {
+    LatencyHistogram h;
+    for (const StreamResult& r : p.streams) {
+        h.total += r.latency.total;
+        for (int b = 0; b <= kLatencyBuckets; ++b) h.counts[b] += r.latency.counts[b];
+    }
+    return h;
+}
+
+static void print_tiles(const PhaseResult& p, int stalled) {
+    std::printf("%-8s %-16s %8s %8s %9s %9s %9s %9s\n", "tile", "decoder", "fps", "Mbit/s", "p50 ms", "p95 ms",
+                "p99 ms", "rebuilds");
+    for (size_t i = 0; i < p.streams.size(); ++i) {
+        const StreamResult& r = p.streams[i];
+        std::printf("cam%-5zu %-16s %8.1f %8.2f %9.2f %9.2f %9.2f %9d%s\n", i + 1,
+                    r.decoder.empty() ? "(none)" : r.decoder.c_str(), r.fps, r.mbps,
+                    latency_quantile_ms(r.latency, 0.50), latency_quantile_ms(r.latency, 0.95),
+                    latency_quantile_ms(r.latency, 0.99), r.errors, (int)i == stalled ? "  (stalled)" : "");
+    }
+}
+
+// One line of the pipelines-vs-mosaic table
+static void print_comparison_row(const char* label, const PhaseResult& p) {
+    double fps = 0.0;
+    for (const StreamResult& r : p.streams) fps += r.fps;
+    const LatencyHistogram h = merged_latency(p);
+    std::printf("%-12s %10.1f %8.1f %8.1f %9.2f %9.2f", label, fps, p.cpu_pct, p.rss_kb / 1024.0,
+                latency_quantile_ms(h, 0.50), latency_quantile_ms(h, 0.95));
+    if (p.have_cpu) std::printf(" %8d\n", p.threads);
+    else std::printf(" %8s\n", "-");
+}
+
+// --mosaic and --mosaic-stall; the server is stopped by the caller.
+static int run_mosaic_modes(const BenchOptions& o, FakeCameraServer* server, GMainLoop* loop) {
+    const FakeCameraOptions& s = o.server;
+    const double min_fps = o.min_fps > 0.0 ? o.min_fps : 0.8 * s.fps;
+    PhaseResult pipes, wall;
+    bool ok = true;
+    if (o.mosaic && !o.mosaic_stall) {
+        g_print("[bench] One pipeline per camera, %d s\n", o.seconds);
+        ok = run_phase(o, server->urls, true, loop, pipes);
+    }
+    if (ok) {
+        g_print("[bench] Mosaic%s, %d s\n", o.mosaic_stall ? " with cam1 stalled" : "", o.seconds);
+        ok = run_mosaic_phase(o, server, o.mosaic_stall ? 0 : -1, loop, wall);
+    }
+    g_main_loop_unref(loop);
+    fake_camera_stop(server);
+    grid_log_stop();
+
+    std::printf("\n%d x %s %dx%d@%d, GOP %d, %d kbit/s (%s), %d s after %d s warm-up\n", s.cameras,
+                s.codec.c_str(), s.width, s.height, s.fps, s.gop, s.bitrate_kbps, server->encoder.c_str(),
+                o.seconds, o.warmup);
+    if (!ok) {
+        std::printf("FAIL: the pipelines could not be built\n");
+        return 1;
+    }
+    print_tiles(wall, o.mosaic_stall ? 0 : -1);
+    for (size_t i = o.mosaic_stall ? 1 : 0; i < wall.streams.size(); ++i) {
+        if (wall.streams[i].fps < min_fps || wall.streams[i].errors) ok = false;
+    }
+    if (o.mosaic_stall) {
+        std::printf("%s\n", ok ? "PASS: the other tiles kept their rate"
+                                : "FAIL: a tile other than the stalled one dropped below --min-fps or was rebuilt");
+        return ok ? 0 : 1;
+    }
+
+    std::printf("\n%-12s %10s %8s %8s %9s %9s %8s\n", "", "total fps", "cpu %", "rss MB", "p50 ms", "p95 ms",
+                "threads");
+    print_comparison_row("pipelines", pipes);
+    print_comparison_row("mosaic", wall);
+    std::printf("latency  rtspsrc output -> fakesink (pipelines), -> mixer pad after the tile scale (mosaic)\n");
+    std::printf("cpu      100%% = one core, encoders included\n");
+    for (const StreamResult& r : pipes.streams) {
+        if (r.errors || r.fps <= 0.0) ok = false;
+    }
+    std::printf("%s\n", ok ? "PASS" : "FAIL: a stream errored or fell below --min-fps");
+    return ok ? 0 : 1;
+}
+
+struct StartupResult {
+    gint64 start_ms {-1};  // until every stream decoded a frame, -1 = timed out
+    gint64 stop_ms {0};
+    int errors {0};
+};
+
+struct LiveWait {
+    const std::vector<std::unique_ptr<BenchStream>>* streams;
+    GMainLoop* loop;
+    gint64 live_us;
+};
+
+static gboolean all_live_cb(gpointer user_data) {
+    LiveWait* w = static_cast<LiveWait*>(user_data);
+    for (auto& s : *w->streams) {
+        if (s->metrics.decoded_frames.load() == 0) return G_SOURCE_CONTINUE;
+    }
+    w->live_us = g_get_monotonic_time();
+    g_main_loop_quit(w->loop);
+    return G_SOURCE_REMOVE;
+}
+
+// One bring-up and exit of every stream, sequential or `concurrent`.
+static void run_startup(const BenchOptions& o, const std::vector<std::string>& urls, bool concurrent, GMainLoop* loop,
+                        StartupResult& out) {
+    std::vector<std::unique_ptr<BenchStream>> streams;
+    const gint64 t0 = g_get_monotonic_time();
+    for (size_t i = 0; i < urls.size(); ++i) {
+        auto s = std::make_unique<BenchStream>();
+        s->name = "cam" + std::to_string(i + 1);
+        s->url = urls[i];
+        decode_chain_init(&s->dc, s->name, s->url, o.software);
+        stream_metrics_init(&s->metrics, s->name);
+        if (!build_stream(s.get(), o, concurrent)) ++out.errors;
+        streams.push_back(std::move(s));
+    }
+
+    LiveWait w {&streams, loop, 0};
+    const guint poll = g_timeout_add(5, all_live_cb, &w);
+    const guint limit = g_timeout_add_seconds(30, quit_cb, loop);
+    g_main_loop_run(loop);
+    if (w.live_us) out.start_ms = (w.live_us - t0) / 1000;
+    for (guint id : {poll, limit}) {
+        if (GSource* src = g_main_context_find_source_by_id(nullptr, id)) g_source_destroy(src);
+    }
+
+    const gint64 t1 = g_get_monotonic_time();
+    if (concurrent) {
+        std::vector<GstElement*> pipelines;
+        for (auto& s : streams) {
+            if (s->watch_id) g_source_remove(s->watch_id);
+            s->watch_id = 0;
+            if (s->pipeline) pipelines.push_back(s->pipeline);
+            s->pipeline = nullptr;
+        }
+        shutdown_all(pipelines);
+    }
+    for (auto& s : streams) {
+        out.errors += s->errors;
+        destroy_stream(s.get());
+    }
+    out.stop_ms = (g_get_monotonic_time() - t1) / 1000;
+}
+
+static bool parse_args(int argc, char** argv, BenchOptions& o) {
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        if (fake_camera_parse_arg(argc, argv, i, o.server)) continue;
+        if (std::strcmp(a, "--seconds") == 0 && i + 1 < argc) o.seconds = std::atoi(argv[++i]);
+        else if (std::strcmp(a, "--warmup") == 0 && i + 1 < argc) o.warmup = std::atoi(argv[++i]);
+        else if (std::strcmp(a, "--udp") == 0) o.udp = true;
+        else if (std::strcmp(a, "--software") == 0) o.software = true;
+        else if (std::strcmp(a, "--no-baseline") == 0) o.baseline = false;
+        else if (std::strcmp(a, "--startup") == 0) o.startup = true;
+        else if (std::strcmp(a, "--mosaic") == 0) o.mosaic = true;
+        else if (std::strcmp(a, "--mosaic-stall") == 0) o.mosaic_stall = true;
+        else if (std::strcmp(a, "--min-fps") == 0 && i + 1 < argc) o.min_fps = std::atof(argv[++i]);
+        else {
+            g_printerr("Unknown option: %s\n", a);
+            return false;
+        }
+    }
+    if (o.mosaic_stall && o.server.cameras < 2) {
+        g_printerr("--mosaic-stall needs at least 2 streams\n");
+        return false;
+    }
+    return fake_camera_options_valid(o.server) && o.seconds > 0 && o.warmup >= 0;
+}
+
+int main(int argc, char** argv) {
+    gst_init(&argc, &argv);
+    grid_log_start("", true);
+    metrics_server_start();
+
+    BenchOptions o;
+    if (!parse_args(argc, argv, o)) {
+        g_printerr("usage: %s [--seconds S] [--warmup S] [--udp] [--software] [--no-baseline] [--startup]\n"
+                   "          [--mosaic] [--mosaic-stall] [--min-fps F]\n%s", argv[0], kFakeCameraUsage);
+        return 2;
+    }
+    decoder_bench_calibrate();
+
+    FakeCameraServer server;
+    if (!fake_camera_start(&server, o.server)) return 1;
+    GMainLoop* loop = g_main_loop_new(nullptr, FALSE);
+
+    if (o.startup) {
+        // Warm-up run: the first one also pays for plugin loading and the encoders' first keyframes
+        StartupResult warm, seq, par;
+        run_startup(o, server.urls, false, loop, warm);
+        run_startup(o, server.urls, false, loop, seq);
+        run_startup(o, server.urls, true, loop, par);
+        g_main_loop_unref(loop);
+        fake_camera_stop(&server);
+        grid_log_stop();
+
+        std::printf("\n%d x %s %dx%d@%d, GOP %d (%s), %s\n", o.server.cameras, o.server.codec.c_str(),
+                    o.server.width, o.server.height, o.server.fps, o.server.gop, server.encoder.c_str(),
+                    o.udp ? "UDP" : "TCP");
+        std::printf("%-12s %16s %12s\n", "", "all live ms", "exit ms");
+        std::printf("%-12s %16" G_GINT64_FORMAT " %12" G_GINT64_FORMAT "\n", "sequential", seq.start_ms, seq.stop_ms);
+        std::printf("%-12s %16" G_GINT64_FORMAT " %12" G_GINT64_FORMAT "\n", "concurrent", par.start_ms, par.stop_ms);
+        const bool ok = seq.start_ms >= 0 && par.start_ms >= 0 && !seq.errors && !par.errors;
+        std::printf("%s\n", ok ? "PASS" : "FAIL: a stream errored or never decoded (-1 = 30 s timeout)");
+        return ok ? 0 : 1;
+    }
+
+    if (o.mosaic || o.mosaic_stall) return run_mosaic_modes(o, &server, loop);
+
+    PhaseResult base, dec;
+    bool ok = true;
+    if (o.baseline) {
+        g_print("[bench] Receive only, %d s\n", o.seconds);
+        ok = run_phase(o, server.urls, false, loop, base);
+    }
+    if (ok) {
+        g_print("[bench] Receive + decode, %d s\n", o.seconds);
+        ok = run_phase(o, server.urls, true, loop, dec);
+    }
+    g_main_loop_unref(loop);
+    fake_camera_stop(&server);
+    grid_log_stop();  // the report goes straight to stdout, after every queued log line
+
+    const FakeCameraOptions& s = o.server;
+    std::printf("\n%d x %s %dx%d@%d, GOP %d, %d kbit/s (%s), %s, %d s after %d s warm-up\n", s.cameras,
+                s.codec.c_str(), s.width, s.height, s.fps, s.gop, s.bitrate_kbps, server.encoder.c_str(),
+                o.udp ? "UDP" : "TCP", o.seconds, o.warmup);
+    std::printf("%-8s %-16s %8s %8s %9s %9s %9s\n", "stream", "decoder", "fps", "Mbit/s", "p50 ms", "p95 ms", "p99 ms");
+    double total_fps = 0.0;
+    for (size_t i = 0; i < dec.streams.size(); ++i) {
+        const StreamResult& r = dec.streams[i];
+        total_fps += r.fps;
+        std::printf("cam%-5zu %-16s %8.1f %8.2f %9.2f %9.2f %9.2f\n", i + 1,
+                    r.decoder.empty() ? "(none)" : r.decoder.c_str(), r.fps, r.mbps,
+                    latency_quantile_ms(r.latency, 0.50), latency_quantile_ms(r.latency, 0.95),
+                    latency_quantile_ms(r.latency, 0.99));
+        if (r.errors || r.fps <= 0.0) ok = false;
+    }
+    std::printf("total    %-16s %8.1f fps (%.0f expected)\n", "", total_fps, (double)s.fps * s.cameras);
+    if (dec.have_cpu) {
+        std::printf("cpu      %.1f%% receive+decode", dec.cpu_pct);
+        if (base.have_cpu) {
+            std::printf(", %.1f%% receive only -> decode chain %.1f%% per stream", base.cpu_pct,
+                        (dec.cpu_pct - base.cpu_pct) / s.cameras);
+        }
+        std::printf(" (100%% = one core, encoders included)\n");
+        std::printf("memory   rss %.1f MB, %d threads\n", dec.rss_kb / 1024.0, dec.threads);
+    }
+    std::printf("latency  rtspsrc output -> fakesink (depay + parse + decode)\n");
+    std::printf("%s\n", ok ? "PASS" : "FAIL: a stream errored or decoded nothing");
+    return ok ? 0 : 1;
+}
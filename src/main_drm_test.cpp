@@ -0,0 +1,134 @@
+// main_drm_test.cpp
+// Headless check of the DRM grid sink (drm_grid.h): N videotestsrc pipelines, each ending in the
+// same mailbox tile sink as the kiosk builds, shown on one DRM grid for S seconds. Meant for vkms,
+// so it runs on a CI box or a VM without a display:
+//
+//   sudo modprobe vkms enable_overlay=1
+//   GRID_DRM_DEVICE=/dev/dri/cardN grid_drm_test [--streams N] [--seconds S] [--fps F] [--zero-copy]
+//
+// The sources produce BGRx at the tile size, so overlay tiles scan out the dumb-buffer pool's
+// dmabufs directly. Prints the plane assignment, the commits, the age of every tile at flip and
+// the copies per tile. Exit code 1 if the grid could not start, nothing was committed or a tile
+// never reached the screen; with --zero-copy also if an overlay tile's frames were copied.
+#include <gst/gst.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "drm_grid.h"
+#include "frame_mailbox.h"
+#include "grid_log.h"
+#include "metrics.h"
+#include "stream_set.h"
+
+struct TestStream {
+    std::string name;
+    GstElement* pipeline {nullptr};
+    FrameMailbox mailbox;
+    StreamMetrics metrics;
+};
+
+struct TestOptions {
+    int streams {4};
+    int seconds {10};
+    int fps {25};
+    bool zero_copy {false};
+};
+
+static bool parse_args(int argc, char** argv, TestOptions& o) {
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        if (std::strcmp(a, "--streams") == 0 && i + 1 < argc) o.streams = std::atoi(argv[++i]);
+        else if (std::strcmp(a, "--seconds") == 0 && i + 1 < argc) o.seconds = std::atoi(argv[++i]);
+        else if (std::strcmp(a, "--fps") == 0 && i + 1 < argc) o.fps = std::atoi(argv[++i]);
+        else if (std::strcmp(a, "--zero-copy") == 0) o.zero_copy = true;
+        else return false;
+    }
+    return o.streams > 0 && o.seconds > 0 && o.fps > 0;
+}
+
+// videotestsrc is-live=true ! video/x-raw,format=BGRx,width=W,height=H,framerate=F/1 ! tile sink:
+// a different pattern per tile
+static bool build_stream(TestStream* s, DrmGrid* grid, int index, int fps) {
+    const TileRect& t = grid->tiles[index]->rect;
+    s->pipeline = gst_pipeline_new((s->name + "_pipe").c_str());
+    GstElement* src = gst_element_factory_make("videotestsrc", nullptr);
+    GstElement* capsf = gst_element_factory_make("capsfilter", nullptr);
+    GstElement* sink = drm_grid_tile_sink(grid, (size_t)index, s->name + "_sink");
+    if (!s->pipeline || !src || !capsf || !sink) {
+        g_printerr("[%s] Failed to create elements\n", s->name.c_str());
+        return false;
+    }
+    g_object_set(G_OBJECT(src), "is-live", TRUE, "pattern", index % 20, NULL);
+    GstCaps* caps = gst_caps_new_simple("video/x-raw", "format", G_TYPE_STRING, "BGRx", "width", G_TYPE_INT, t.w,
+                                        "height", G_TYPE_INT, t.h, "framerate", GST_TYPE_FRACTION, fps, 1, NULL);
+    g_object_set(G_OBJECT(capsf), "caps", caps, NULL);
+    gst_caps_unref(caps);
+    gst_bin_add_many(GST_BIN(s->pipeline), src, capsf, sink, NULL);
+    if (!gst_element_link_many(src, capsf, sink, NULL)) {
+        g_printerr("[%s] Failed to link\n", s->name.c_str());
+        return false;
+    }
+    return gst_element_set_state(s->pipeline, GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE;
+}
+
+int main(int argc, char** argv) {
+    gst_init(&argc, &argv);
+    grid_log_start("", true);
+
+    TestOptions o;
+    if (!parse_args(argc, argv, o)) {
+        g_printerr("usage: %s [--streams N] [--seconds S] [--fps F] [--zero-copy]\n", argv[0]);
+        return 2;
+    }
+
+    DrmGrid grid;
+    if (!drm_grid_open(&grid)) {
+        grid_log_stop();
+        return 1;
+    }
+    const GridLayout layout = grid_layout_for((size_t)o.streams);
+    std::vector<std::unique_ptr<TestStream>> streams;
+    for (int i = 0; i < o.streams; ++i) {
+        auto s = std::make_unique<TestStream>();
+        s->name = "tile" + std::to_string(i);
+        stream_metrics_init(&s->metrics, s->name);
+        s->mailbox.metrics = &s->metrics;
+        drm_grid_add_tile(&grid, &s->mailbox, grid_tile(layout, i, grid.width, grid.height), &s->metrics);
+        streams.push_back(std::move(s));
+    }
+    bool ok = drm_grid_start(&grid);
+    std::vector<bool> overlay;  // drm_grid_stop() releases the planes
+    for (const auto& t : grid.tiles) overlay.push_back(t->plane_id != 0);
+    for (int i = 0; ok && i < o.streams; ++i) {
+        ok = build_stream(streams[i].get(), &grid, i, o.fps);
+    }
+    if (ok) g_usleep((gulong)o.seconds * G_USEC_PER_SEC);
+
+    for (auto& s : streams) {
+        if (s->pipeline) {
+            gst_element_set_state(s->pipeline, GST_STATE_NULL);
+            gst_object_unref(s->pipeline);
+        }
+    }
+    drm_grid_stop(&grid);
+    int unseen = 0;
+    int copied = 0;  // overlay tiles whose frames were converted or copied on the CPU
+    for (size_t i = 0; i < grid.tiles.size(); ++i) {
+        const StreamMetrics* m = grid.tiles[i]->metrics;
+        if (grid.tiles[i]->seq == 0) ++unseen;
+        if (overlay[i] && (m->convert_copies.load() || m->display_copies.load())) ++copied;
+    }
+    const guint64 commits = grid.commits.load();
+    grid_log_stop();
+
+    std::printf("\n%d tiles on %s %dx%d@%d for %d s: %" G_GUINT64_FORMAT " commits (%.1f/s), %d tiles never shown, "
+                "%d overlay tiles copied\n",
+                o.streams, grid.device.c_str(), grid.width, grid.height, grid.refresh_hz, o.seconds, commits,
+                (double)commits / o.seconds, unseen, copied);
+    return ok && commits > 0 && unseen == 0 && (!o.zero_copy || copied == 0) ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+// main_fake_camera.cpp
+// Stand-in camera server for testing the viewers' reconnect and backoff on one machine:
+// N synthetic H.264/H.265 cameras over RTSP (TCP and UDP) with scheduled faults.
+//
+//   grid_fake_camera [camera/server/impairment options] [--write-cameras FILE] [--duration S]
+//
+// --write-cameras writes a camera list for the viewers' --cameras option. Example, a camera that
+// loses 2% of its packets, ends its stream every 60 s and drops off the network for 5 s every
+// 3 minutes:
+//
+//   grid_fake_camera --streams 4 --loss 2 --eos-every 60 --disconnect-every 180 --down 5 \
+//                    --write-cameras /tmp/fake.txt
+//   gstreamer_demo --cameras /tmp/fake.txt
+#include <gst/gst.h>
+#ifdef G_OS_UNIX
+#include <glib-unix.h>
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "fake_camera.h"
+#include "grid_log.h"
+
+struct ToolState {
+    FakeCameraServer* server {nullptr};
+    GMainLoop* loop {nullptr};
+};
+
+static gboolean quit_cb(gpointer user_data) {
+    g_main_loop_quit(static_cast<ToolState*>(user_data)->loop);
+    return G_SOURCE_REMOVE;
+}
+
+// Packets sent/dropped per camera since the last report.
+static gboolean report_cb(gpointer user_data) {
+    ToolState* st = static_cast<ToolState*>(user_data);
+    for (auto& fm : st->server->mounts) {
+        guint64 packets = fm->packets.exchange(0);
+        guint64 dropped = fm->dropped.exchange(0);
+        if (packets) {
+            g_print("[fakecam] cam%d: %llu RTP packets, %llu dropped\n", fm->index + 1,
+                    (unsigned long long)packets, (unsigned long long)dropped);
+        }
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static bool write_cameras(const std::string& path, const FakeCameraServer& s) {
+    std::ofstream ofs(path);
+    if (!ofs) return false;
+    ofs << "# grid_fake_camera: " << s.opts.cameras << " x " << s.opts.codec << " " << s.opts.width << "x"
+        << s.opts.height << "@" << s.opts.fps << "\n";
+    for (size_t i = 0; i < s.urls.size(); ++i) {
+        ofs << "cam" << i + 1 << " " << s.urls[i] << " -\n";  // no sub-stream
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    gst_init(&argc, &argv);
+    grid_log_start("", true);
+
+    FakeCameraOptions o;
+    std::string cameras_file;
+    int duration = 0;
+    bool ok = true;
+    for (int i = 1; i < argc && ok; ++i) {
+        if (fake_camera_parse_arg(argc, argv, i, o)) continue;
+        if (std::strcmp(argv[i], "--write-cameras") == 0 && i + 1 < argc) cameras_file = argv[++i];
+        else if (std::strcmp(argv[i], "--duration") == 0 && i + 1 < argc) duration = std::atoi(argv[++i]);
+        else ok = false;
+    }
+    if (!ok || !fake_camera_options_valid(o)) {
+        g_printerr("usage: %s [--write-cameras FILE] [--duration S]\n%s", argv[0], kFakeCameraUsage);
+        return 2;
+    }
+
+    FakeCameraServer server;
+    if (!fake_camera_start(&server, o)) return 1;
+    if (!cameras_file.empty()) {
+        if (write_cameras(cameras_file, server)) g_print("[fakecam] Camera list written to %s\n", cameras_file.c_str());
+        else g_printerr("[fakecam] Cannot write %s\n", cameras_file.c_str());
+    }
+
+    ToolState st;
+    st.server = &server;
+    st.loop = g_main_loop_new(nullptr, FALSE);
+    if (o.impair.loss_pct > 0.0) g_timeout_add_seconds(10, report_cb, &st);
+    if (duration > 0) g_timeout_add_seconds((guint)duration, quit_cb, &st);
+#ifdef G_OS_UNIX
+    g_unix_signal_add(SIGINT, quit_cb, &st);
+    g_unix_signal_add(SIGTERM, quit_cb, &st);
+#endif
+    g_main_loop_run(st.loop);
+
+    g_print("[fakecam] Stopping (%llu scheduled disconnects)\n", (unsigned long long)server.disconnects.load());
+    fake_camera_stop(&server);
+    g_main_loop_unref(st.loop);
+    return 0;
+}
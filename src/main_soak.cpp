@@ -0,0 +1,469 @@
+// main_soak.cpp
+// Reconnect-storm soak test: every camera of an in-process fake camera server is made to fail
+// thousands of times (its connection dropped -> rtspsrc ERROR, or its stream ended -> EOS), and
+// the client recovers the way one of the viewers does:
+//
+//   rebuild  tear the pipeline down and build a new one (main.cpp full path, kms/swdec workers)
+//   restart  NULL -> PLAYING on the same pipeline, decode chain left linked (main_pi_gtk_opt)
+//   ready    READY -> PLAYING on the same pipeline (main_pi)
+//   swap     replace only rtspsrc, rebuild after 3 swaps without a frame (main.cpp fast path)
+//
+//   gstreamer_demo_soak [--mode M] [--cycles N] [--faults error|eos|both] [--fault-after MIN-MAX]
+//                       [--backoff MS] [--recover-timeout S] [--sample S] [--csv FILE]
+//                       [--warmup-cycles N] [--max-rss-growth KB] [--software] [fake camera options]
+//
+// Recorded: time to recover (fault injected -> first frame at the sink after the reconnect) per
+// cycle, and RSS, threads and fds every --sample seconds. The run fails when a recovery times out
+// more than once per 100 cycles, when RSS keeps growing after the warm-up (least-squares slope
+// above --max-rss-growth KB per 1000 cycles), or when threads or fds at the end exceed the level
+// after the warm-up by more than a few per camera.
+#include <gst/gst.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "codec_chain.h"
+#include "decoder_bench.h"
+#include "fake_camera.h"
+#include "grid_log.h"
+#include "proc_stats.h"
+
+enum class SoakMode { Rebuild, Restart, Ready, Swap };
+
+enum class SoakState {
+    Connecting,  // first connect, not counted
+    Streaming,   // frames flowing, next fault scheduled
+    Faulted,     // fault injected, waiting for ERROR/EOS on the bus
+    Recovering,  // reconnected (or scheduled to), waiting for the first frame
+};
+
+struct SoakOptions {
+    FakeCameraOptions server;
+    SoakMode mode {SoakMode::Rebuild};
+    int cycles {1000};             // per camera
+    bool errors {true};
+    bool eos {true};
+    int fault_min_ms {200};
+    int fault_max_ms {1000};
+    int backoff_ms {100};
+    int recover_timeout_s {10};
+    int sample_s {5};
+    int warmup_cycles {50};        // per camera, before the memory baseline
+    double max_rss_growth_kb {2048.0};  // per 1000 cycles
+    bool software {false};
+    std::string csv;
+};
+
+struct SoakStream {
+    int index {0};
+    std::string name;
+    std::string url;
+
+    GstElement* pipeline {nullptr};
+    GstElement* src {nullptr};
+    GstElement* sink {nullptr};
+    DecodeChain dc;
+    FirstFrameTimer ttff;
+    guint watch_id {0};
+
+    SoakState state {SoakState::Connecting};
+    guint timer_id {0};       // next fault or pending reconnect
+    gint64 fault_us {0};      // when the current outage started
+    gint64 armed_us {0};      // when the reconnect started (ttff is relative to it)
+    int fast_attempts {0};
+    bool decoder_failed {false};  // the next reconnect rebuilds, whatever the mode
+    int cycles {0};
+    bool done {false};
+};
+
+struct SoakSample {
+    double t_s;
+    int cycles;
+    long rss_kb;
+    int threads;
+    int fds;
+};
+
+struct Soak {
+    SoakOptions o;
+    FakeCameraServer server;
+    std::vector<std::unique_ptr<SoakStream>> streams;
+    GMainLoop* loop {nullptr};
+    GRand* rand {nullptr};
+    FILE* csv {nullptr};
+    gint64 start_us {0};
+
+    std::vector<double> ttr_ms;
+    int total_cycles {0};
+    int error_faults {0};
+    int eos_faults {0};
+    int unplanned {0};     // ERROR/EOS that the soak did not inject
+    int retries {0};       // ERROR/EOS while already recovering
+    int timeouts {0};
+    std::vector<SoakSample> samples;
+};
+
+static Soak g_soak;
+
+static void on_src_pad_added(GstElement* /*src*/, GstPad* pad, gpointer user_data) {
+    SoakStream* s = static_cast<SoakStream*>(user_data);
+    decode_chain_link_pad(&s->dc, GST_BIN(s->pipeline), pad, s->sink);
+}
+
+static gboolean on_bus_msg(GstBus* bus, GstMessage* msg, gpointer user_data);
+
+static bool build_stream(SoakStream* s) {
+    s->pipeline = gst_pipeline_new((s->name + "_pipe").c_str());
+    s->src      = gst_element_factory_make("rtspsrc", (s->name + "_src").c_str());
+    s->sink     = gst_element_factory_make("fakesink", (s->name + "_sink").c_str());
+    if (!s->pipeline || !s->src || !s->sink) {
+        g_printerr("[%s] Failed to create core elements\n", s->name.c_str());
+        return false;
+    }
+    g_object_set(G_OBJECT(s->src), "location", s->url.c_str(), "latency", 0, "protocols", 4 /* TCP */, NULL);
+    g_object_set(G_OBJECT(s->sink), "sync", FALSE, "async", FALSE, NULL);
+    gst_bin_add_many(GST_BIN(s->pipeline), s->src, s->sink, NULL);
+    decode_chain_prebuild(&s->dc, GST_BIN(s->pipeline), s->sink);
+    first_frame_timer_attach(&s->ttff, s->sink);
+    g_signal_connect(s->src, "pad-added", G_CALLBACK(on_src_pad_added), s);
+
+    GstBus* bus = gst_element_get_bus(s->pipeline);
+    s->watch_id = gst_bus_add_watch(bus, on_bus_msg, s);
+    gst_object_unref(bus);
+    return gst_element_set_state(s->pipeline, GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE;
+}
+
+static void destroy_stream(SoakStream* s) {
+    if (s->watch_id) g_source_remove(s->watch_id);
+    s->watch_id = 0;
+    if (s->pipeline) {
+        gst_element_set_state(s->pipeline, GST_STATE_NULL);
+        gst_object_unref(s->pipeline);
+    }
+    decode_chain_reset(&s->dc);
+    s->pipeline = s->src = s->sink = nullptr;
+}
+
+static bool reconnect(SoakStream* s) {
+    first_frame_timer_arm(&s->ttff);
+    s->armed_us = g_get_monotonic_time();
+    SoakMode mode = s->decoder_failed ? SoakMode::Rebuild : g_soak.o.mode;
+    s->decoder_failed = false;
+    switch (mode) {
+    case SoakMode::Restart:
+    case SoakMode::Ready:
+        if (!s->pipeline) break;
+        gst_element_set_state(s->pipeline, mode == SoakMode::Restart ? GST_STATE_NULL : GST_STATE_READY);
+        return gst_element_set_state(s->pipeline, GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE;
+    case SoakMode::Swap:
+        if (!s->pipeline || !s->dc.depay || s->fast_attempts >= 3) break;
+        if (GstElement* src = codec_chain_swap_source(s->pipeline, s->src, s->dc.depay)) {
+            s->src = src;
+            g_signal_connect(src, "pad-added", G_CALLBACK(on_src_pad_added), s);
+            ++s->fast_attempts;
+            if (gst_element_sync_state_with_parent(src)) {
+                gst_bin_recalculate_latency(GST_BIN(s->pipeline));
+                return true;
+            }
+        }
+        break;
+    case SoakMode::Rebuild:
+        break;
+    }
+    s->fast_attempts = 0;
+    destroy_stream(s);
+    return build_stream(s);
+}
+
+static gboolean reconnect_cb(gpointer user_data) {
+    SoakStream* s = static_cast<SoakStream*>(user_data);
+    s->timer_id = 0;
+    if (!reconnect(s)) g_printerr("[%s] Reconnect failed; waiting for the recovery timeout\n", s->name.c_str());
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean inject_fault_cb(gpointer user_data) {
+    SoakStream* s = static_cast<SoakStream*>(user_data);
+    s->timer_id = 0;
+    const SoakOptions& o = g_soak.o;
+    bool eos = o.eos && (!o.errors || (s->cycles % 2) == 1);
+    s->state = SoakState::Faulted;
+    s->fault_us = g_get_monotonic_time();
+    if (eos) {
+        ++g_soak.eos_faults;
+        fake_camera_end_stream(&g_soak.server, s->index);
+    } else {
+        ++g_soak.error_faults;
+        fake_camera_drop_clients(&g_soak.server, s->index);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+static void schedule_fault(SoakStream* s) {
+    const SoakOptions& o = g_soak.o;
+    s->state = SoakState::Streaming;
+    guint ms = (guint)g_rand_int_range(g_soak.rand, o.fault_min_ms, o.fault_max_ms + 1);
+    s->timer_id = g_timeout_add(ms, inject_fault_cb, s);
+}
+
+static gboolean on_bus_msg(GstBus* /*bus*/, GstMessage* msg, gpointer user_data) {
+    SoakStream* s = static_cast<SoakStream*>(user_data);
+    GstMessageType type = GST_MESSAGE_TYPE(msg);
+    if ((type != GST_MESSAGE_ERROR && type != GST_MESSAGE_EOS) || s->done) return TRUE;
+    if (s->pipeline && codec_chain_message_is_stale(s->pipeline, msg)) return TRUE;  // from the swapped-out source
+    if (type == GST_MESSAGE_ERROR && decode_chain_is_decoder(&s->dc, GST_MESSAGE_SRC(msg))) {
+        decode_chain_mark_failed(&s->dc);
+        s->decoder_failed = true;
+    }
+
+    switch (s->state) {
+    case SoakState::Streaming:
+        ++g_soak.unplanned;
+        if (s->timer_id) g_source_remove(s->timer_id);
+        s->timer_id = 0;
+        s->fault_us = g_get_monotonic_time();
+        break;
+    case SoakState::Faulted:
+        break;
+    case SoakState::Connecting:
+    case SoakState::Recovering:
+        ++g_soak.retries;
+        if (s->timer_id) return TRUE;  // a reconnect is already scheduled
+        break;
+    }
+    if (s->state != SoakState::Connecting) s->state = SoakState::Recovering;
+    s->timer_id = g_timeout_add((guint)g_soak.o.backoff_ms, reconnect_cb, s);
+    return TRUE;
+}
+
+static void sample(Soak* k) {
+    ProcSample p;
+    if (!proc_sample(p)) return;
+    SoakSample smp { (g_get_monotonic_time() - k->start_us) / 1e6, k->total_cycles, p.rss_kb, p.threads, p.fds };
+    k->samples.push_back(smp);
+    g_print("[soak] %6.0f s  cycles %6d  rss %7.1f MB  threads %3d  fds %4d\n", smp.t_s, smp.cycles,
+            smp.rss_kb / 1024.0, smp.threads, smp.fds);
+    if (k->csv) {
+        std::fprintf(k->csv, "%.1f,%d,%ld,%d,%d\n", smp.t_s, smp.cycles, smp.rss_kb, smp.threads, smp.fds);
+        std::fflush(k->csv);
+    }
+}
+
+static gboolean sample_cb(gpointer user_data) {
+    sample(static_cast<Soak*>(user_data));
+    return G_SOURCE_CONTINUE;
+}
+
+// 20 ms: completed recoveries, recovery timeouts, end of the run.
+static gboolean poll_cb(gpointer user_data) {
+    Soak* k = static_cast<Soak*>(user_data);
+    gint64 now = g_get_monotonic_time();
+    bool all_done = true;
+    for (auto& sp : k->streams) {
+        SoakStream* s = sp.get();
+        if (s->done) continue;
+        all_done = false;
+        gint64 ttff = first_frame_timer_take(&s->ttff);
+        if (ttff >= 0 && (s->state == SoakState::Connecting || s->state == SoakState::Recovering)) {
+            if (s->state == SoakState::Recovering) {
+                k->ttr_ms.push_back((s->armed_us - s->fault_us) / 1000.0 + (double)ttff);
+                ++s->cycles;
+                ++k->total_cycles;
+            }
+            s->fast_attempts = 0;
+            if (s->cycles >= k->o.cycles) {
+                s->done = true;
+                destroy_stream(s);
+                continue;
+            }
+            schedule_fault(s);
+        } else if ((s->state == SoakState::Faulted || s->state == SoakState::Recovering) &&
+                   now - s->fault_us > (gint64)k->o.recover_timeout_s * G_USEC_PER_SEC) {
+            ++k->timeouts;
+            g_printerr("[%s] No frame %d s after the fault; rebuilding\n", s->name.c_str(), k->o.recover_timeout_s);
+            if (s->timer_id) g_source_remove(s->timer_id);
+            s->timer_id = 0;
+            s->fast_attempts = 0;
+            destroy_stream(s);
+            first_frame_timer_arm(&s->ttff);
+            s->armed_us = s->fault_us = now;
+            s->state = SoakState::Recovering;
+            if (!build_stream(s)) g_printerr("[%s] Rebuild failed\n", s->name.c_str());
+        }
+    }
+    if (all_done) g_main_loop_quit(k->loop);
+    return G_SOURCE_CONTINUE;
+}
+
+static double percentile(std::vector<double>& v, double p) {
+    if (v.empty()) return -1.0;
+    size_t i = std::min(v.size() - 1, (size_t)(p * v.size()));
+    std::nth_element(v.begin(), v.begin() + i, v.end());
+    return v[i];
+}
+
+// Least-squares slope of RSS (KB) over cycles.
+static double rss_slope(const std::vector<SoakSample>& v) {
+    double n = (double)v.size(), sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (const SoakSample& s : v) {
+        sx += s.cycles;
+        sy += s.rss_kb;
+        sxx += (double)s.cycles * s.cycles;
+        sxy += (double)s.cycles * s.rss_kb;
+    }
+    double d = n * sxx - sx * sx;
+    return d > 0 ? (n * sxy - sx * sy) / d : 0.0;
+}
+
+static bool parse_args(int argc, char** argv, SoakOptions& o) {
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        if (fake_camera_parse_arg(argc, argv, i, o.server)) continue;
+        const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (std::strcmp(a, "--software") == 0) { o.software = true; continue; }
+        if (!v) return false;
+        ++i;
+        if (std::strcmp(a, "--cycles") == 0) o.cycles = std::atoi(v);
+        else if (std::strcmp(a, "--backoff") == 0) o.backoff_ms = std::atoi(v);
+        else if (std::strcmp(a, "--recover-timeout") == 0) o.recover_timeout_s = std::atoi(v);
+        else if (std::strcmp(a, "--sample") == 0) o.sample_s = std::atoi(v);
+        else if (std::strcmp(a, "--warmup-cycles") == 0) o.warmup_cycles = std::atoi(v);
+        else if (std::strcmp(a, "--max-rss-growth") == 0) o.max_rss_growth_kb = std::atof(v);
+        else if (std::strcmp(a, "--csv") == 0) o.csv = v;
+        else if (std::strcmp(a, "--fault-after") == 0) {
+            if (std::sscanf(v, "%d-%d", &o.fault_min_ms, &o.fault_max_ms) != 2) return false;
+        } else if (std::strcmp(a, "--faults") == 0) {
+            o.errors = std::strcmp(v, "eos") != 0;
+            o.eos = std::strcmp(v, "error") != 0;
+        } else if (std::strcmp(a, "--mode") == 0) {
+            if (std::strcmp(v, "rebuild") == 0) o.mode = SoakMode::Rebuild;
+            else if (std::strcmp(v, "restart") == 0) o.mode = SoakMode::Restart;
+            else if (std::strcmp(v, "ready") == 0) o.mode = SoakMode::Ready;
+            else if (std::strcmp(v, "swap") == 0) o.mode = SoakMode::Swap;
+            else return false;
+        } else {
+            g_printerr("Unknown option: %s\n", a);
+            return false;
+        }
+    }
+    return fake_camera_options_valid(o.server) && o.cycles > 0 && o.backoff_ms >= 0 && o.recover_timeout_s > 0 &&
+           o.sample_s > 0 && o.warmup_cycles >= 0 && o.fault_min_ms >= 0 && o.fault_max_ms >= o.fault_min_ms;
+}
+
+static const char* mode_name(SoakMode m) {
+    switch (m) {
+    case SoakMode::Rebuild: return "rebuild";
+    case SoakMode::Restart: return "restart";
+    case SoakMode::Ready: return "ready";
+    case SoakMode::Swap: return "swap";
+    }
+    return "?";
+}
+
+int main(int argc, char** argv) {
+    gst_init(&argc, &argv);
+    grid_log_start("", true);
+
+    Soak& k = g_soak;
+    // Small and fast by default: the point is the reconnect path, not the decoder
+    k.o.server.width = 320;
+    k.o.server.height = 240;
+    k.o.server.gop = k.o.server.fps;
+    k.o.server.bitrate_kbps = 500;
+    k.o.server.protocols = "tcp";
+    if (!parse_args(argc, argv, k.o)) {
+        g_printerr("usage: %s [--mode rebuild|restart|ready|swap] [--cycles N] [--faults error|eos|both]\n"
+                   "       [--fault-after MIN-MAX ms] [--backoff MS] [--recover-timeout S] [--sample S]\n"
+                   "       [--csv FILE] [--warmup-cycles N] [--max-rss-growth KB] [--software]\n%s",
+                   argv[0], kFakeCameraUsage);
+        return 2;
+    }
+    decoder_bench_calibrate();
+    if (!fake_camera_start(&k.server, k.o.server)) return 1;
+
+    if (!k.o.csv.empty()) {
+        k.csv = std::fopen(k.o.csv.c_str(), "w");
+        if (k.csv) std::fprintf(k.csv, "seconds,cycles,rss_kb,threads,fds\n");
+        else g_printerr("[soak] Cannot write %s\n", k.o.csv.c_str());
+    }
+    k.rand = g_rand_new_with_seed(k.o.server.seed);
+    k.loop = g_main_loop_new(nullptr, FALSE);
+    k.start_us = g_get_monotonic_time();
+    g_print("[soak] %s mode, %d cycles x %zu cameras\n", mode_name(k.o.mode), k.o.cycles, k.server.urls.size());
+
+    for (size_t i = 0; i < k.server.urls.size(); ++i) {
+        auto s = std::make_unique<SoakStream>();
+        s->index = (int)i;
+        s->name = "cam" + std::to_string(i + 1);
+        s->url = k.server.urls[i];
+        decode_chain_init(&s->dc, s->name, s->url, k.o.software);
+        first_frame_timer_arm(&s->ttff);
+        s->fault_us = s->armed_us = g_get_monotonic_time();
+        if (!build_stream(s.get())) g_printerr("[%s] Failed to start\n", s->name.c_str());
+        k.streams.push_back(std::move(s));
+    }
+    sample(&k);
+    g_timeout_add(20, poll_cb, &k);
+    g_timeout_add_seconds((guint)k.o.sample_s, sample_cb, &k);
+    g_main_loop_run(k.loop);
+    sample(&k);
+
+    for (auto& s : k.streams) destroy_stream(s.get());
+    fake_camera_stop(&k.server);
+    if (k.csv) std::fclose(k.csv);
+    grid_log_stop();  // the report goes straight to stdout, after every queued log line
+
+    // ---- Report ----
+    bool ok = true;
+    std::printf("\n%s mode: %d recoveries (%d ERROR, %d EOS injected, %d unplanned), %d retries, %d timeouts\n",
+                mode_name(k.o.mode), k.total_cycles, k.error_faults, k.eos_faults, k.unplanned, k.retries, k.timeouts);
+    std::printf("time to recover: p50 %.0f ms, p90 %.0f ms, p99 %.0f ms, max %.0f ms\n", percentile(k.ttr_ms, 0.50),
+                percentile(k.ttr_ms, 0.90), percentile(k.ttr_ms, 0.99), percentile(k.ttr_ms, 1.0));
+    if (k.timeouts * 100 > std::max(1, k.total_cycles)) {
+        std::printf("FAIL: %d recoveries timed out\n", k.timeouts);
+        ok = false;
+    }
+
+    const int warm = k.o.warmup_cycles * (int)k.streams.size();
+    std::vector<SoakSample> after;
+    for (const SoakSample& s : k.samples) {
+        if (s.cycles >= warm) after.push_back(s);
+    }
+    if (after.size() < 3) {
+        std::printf("memory: too few samples after %d warm-up cycles (use more --cycles or a shorter --sample)\n", warm);
+    } else {
+        const SoakSample& first = after.front();
+        const SoakSample& last = after.back();
+        double slope = rss_slope(after) * 1000.0;
+        std::printf("memory: rss %.1f -> %.1f MB (%+.0f KB per 1000 cycles), threads %d -> %d, fds %d -> %d\n",
+                    first.rss_kb / 1024.0, last.rss_kb / 1024.0, slope, first.threads, last.threads, first.fds,
+                    last.fds);
+        const int n = (int)k.streams.size();
+        int max_threads = 0, max_fds = 0;
+        for (size_t i = 0; i < after.size() / 3 + 1; ++i) {
+            max_threads = std::max(max_threads, after[i].threads);
+            max_fds = std::max(max_fds, after[i].fds);
+        }
+        if (slope > k.o.max_rss_growth_kb) {
+            std::printf("FAIL: RSS grows by %.0f KB per 1000 cycles (limit %.0f)\n", slope, k.o.max_rss_growth_kb);
+            ok = false;
+        }
+        if (last.threads > max_threads + n + 4) {
+            std::printf("FAIL: threads grew from %d to %d\n", max_threads, last.threads);
+            ok = false;
+        }
+        if (last.fds > max_fds + 2 * n + 8) {
+            std::printf("FAIL: fds grew from %d to %d\n", max_fds, last.fds);
+            ok = false;
+        }
+    }
+    std::printf("%s\n", ok ? "PASS" : "FAIL");
+    g_main_loop_unref(k.loop);
+    g_rand_free(k.rand);
+    return ok ? 0 : 1;
+}
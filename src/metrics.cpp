@@ -0,0 +1,451 @@
+// metrics.cpp
+#include "metrics.h"
+
+#include <gio/gio.h>
+#ifdef G_OS_UNIX
+#include <gio/gunixsocketaddress.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "grid_log.h"
+#include "warn_agg.h"
+#include "watchdog.h"
+#ifdef __linux__
+#include "proc_stats.h"
+#endif
+
+// Upper bounds of the latency histogram, milliseconds (+Inf is latency_count)
+static const int kBucketMs[kLatencyBuckets] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000 };
+
+static std::mutex registry_mutex;
+static std::vector<StreamMetrics*> registry;
+
+StreamMetrics::~StreamMetrics() {
+    watchdog_forget(this);
+    g_weak_ref_clear(&source);
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    registry.erase(std::remove(registry.begin(), registry.end(), this), registry.end());
+}
+
+void stream_metrics_init(StreamMetrics* m, const std::string& name) {
+    m->name = name;
+    stream_state_init(&m->state, name);
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    if (std::find(registry.begin(), registry.end(), m) == registry.end()) registry.push_back(m);
+}
+
+// ---- Probes ----
+
+// First packet of every frame (new PTS): remember when it left rtspsrc, update the arrival jitter
+// (RFC 3550 style: deviation of the arrival spacing from the PTS spacing, smoothed over 16).
+static void on_ingress_buffer(StreamMetrics* m, GstBuffer* buf, gint64 now) {
+    m->ingress_bytes.fetch_add(gst_buffer_get_size(buf), std::memory_order_relaxed);
+    guint64 pts = GST_BUFFER_PTS(buf);
+    if (!GST_CLOCK_TIME_IS_VALID(pts) || pts == m->last_pts) return;
+
+    if (GST_CLOCK_TIME_IS_VALID(m->last_pts) && pts > m->last_pts) {
+        gint64 d = (now - m->last_arrival_us) - (gint64)((pts - m->last_pts) / 1000);
+        m->jitter += ((double)(d < 0 ? -d : d) - m->jitter) / 16.0;
+        m->jitter_us.store((gint64)m->jitter, std::memory_order_relaxed);
+    }
+    m->last_pts = pts;
+    m->last_arrival_us = now;
+
+    FrameStamp& s = m->stamps[m->stamp_pos.fetch_add(1, std::memory_order_relaxed) % G_N_ELEMENTS(m->stamps)];
+    s.arrival_us.store(now, std::memory_order_relaxed);
+    s.pts.store(pts, std::memory_order_release);
+}
+
+static GstPadProbeReturn on_ingress(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+    StreamMetrics* m = static_cast<StreamMetrics*>(user_data);
+    gint64 now = g_get_monotonic_time();
+    m->last_buffer_us.store(now, std::memory_order_relaxed);
+    stream_state_mark(&m->state, StreamMark::FirstRtp);
+    if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+        on_ingress_buffer(m, GST_PAD_PROBE_INFO_BUFFER(info), now);
+    } else if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+        GstBufferList* list = GST_PAD_PROBE_INFO_BUFFER_LIST(info);
+        for (guint i = 0, n = gst_buffer_list_length(list); i < n; ++i) {
+            on_ingress_buffer(m, gst_buffer_list_get(list, i), now);
+        }
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn on_decoded(GstPad* /*pad*/, GstPadProbeInfo* /*info*/, gpointer user_data) {
+    StreamMetrics* m = static_cast<StreamMetrics*>(user_data);
+    m->decoded_frames.fetch_add(1, std::memory_order_relaxed);
+    stream_state_mark(&m->state, StreamMark::Decoded);
+    return GST_PAD_PROBE_OK;
+}
+
+static void observe(std::atomic<guint64>* buckets, std::atomic<guint64>& count, std::atomic<guint64>& sum_us,
+                    gint64 us) {
+    int b = 0;
+    while (b < kLatencyBuckets && us > (gint64)kBucketMs[b] * 1000) ++b;
+    if (b < kLatencyBuckets) buckets[b].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum_us.fetch_add((guint64)us, std::memory_order_relaxed);
+}
+
+static GstPadProbeReturn on_display(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+    StreamMetrics* m = static_cast<StreamMetrics*>(user_data);
+    m->displayed_frames.fetch_add(1, std::memory_order_relaxed);
+    stream_state_mark(&m->state, StreamMark::Displayed);
+
+    guint64 pts = GST_BUFFER_PTS(GST_PAD_PROBE_INFO_BUFFER(info));
+    if (!GST_CLOCK_TIME_IS_VALID(pts)) return GST_PAD_PROBE_OK;
+    // Newest stamps first; decoders keep the PTS, so the frame is found unless it is very old
+    const unsigned n = G_N_ELEMENTS(m->stamps);
+    unsigned pos = m->stamp_pos.load(std::memory_order_relaxed);
+    for (unsigned i = 1; i <= n; ++i) {
+        const FrameStamp& s = m->stamps[(pos - i) % n];
+        if (s.pts.load(std::memory_order_acquire) != pts) continue;
+        gint64 lat = g_get_monotonic_time() - s.arrival_us.load(std::memory_order_relaxed);
+        if (lat < 0) break;
+        observe(m->latency_buckets, m->latency_count, m->latency_sum_us, lat);
+        break;
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+static void on_sdp(GstElement* /*src*/, gpointer /*sdp*/, gpointer user_data) {
+    stream_state_mark(&static_cast<StreamMetrics*>(user_data)->state, StreamMark::Sdp);
+}
+
+void stream_metrics_watch_source(StreamMetrics* m, GstElement* rtspsrc) {
+    if (!m || !rtspsrc) return;
+    if (g_signal_lookup("on-sdp", G_OBJECT_TYPE(rtspsrc))) {
+        g_signal_connect(rtspsrc, "on-sdp", G_CALLBACK(on_sdp), m);
+    }
+    g_weak_ref_set(&m->source, rtspsrc);
+    watchdog_watch(m);
+}
+
+void stream_metrics_watch_ingress(StreamMetrics* m, GstPad* pad) {
+    if (!m || !pad) return;
+    stream_state_mark(&m->state, StreamMark::Pads);
+    gst_pad_add_probe(pad, (GstPadProbeType)(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST),
+                      on_ingress, m, nullptr);
+}
+
+void stream_metrics_watch_decoder(StreamMetrics* m, GstElement* dec) {
+    if (!m || !dec) return;
+    GstPad* pad = gst_element_get_static_pad(dec, "src");
+    if (!pad) return;
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, on_decoded, m, nullptr);
+    gst_object_unref(pad);
+}
+
+void stream_metrics_watch_display(StreamMetrics* m, GstPad* pad) {
+    if (!m || !pad) return;
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, on_display, m, nullptr);
+}
+
+void stream_metrics_watch_sink(StreamMetrics* m, GstElement* sink) {
+    if (!m || !sink) return;
+    GstPad* pad = gst_element_get_static_pad(sink, "sink");
+    if (!pad) return;
+    stream_metrics_watch_display(m, pad);
+    gst_object_unref(pad);
+}
+
+void stream_metrics_qos(StreamMetrics* m) {
+    m->qos_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void stream_metrics_reconnect(StreamMetrics* m) {
+    m->reconnects.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void histogram(const std::atomic<guint64>* buckets, const std::atomic<guint64>& count, LatencyHistogram& out) {
+    guint64 in_buckets = 0;
+    for (int b = 0; b < kLatencyBuckets; ++b) {
+        out.counts[b] = buckets[b].load(std::memory_order_relaxed);
+        in_buckets += out.counts[b];
+    }
+    out.total = std::max(count.load(std::memory_order_relaxed), in_buckets);
+    out.counts[kLatencyBuckets] = out.total - in_buckets;
+}
+
+void stream_metrics_latency(const StreamMetrics* m, LatencyHistogram& out) {
+    histogram(m->latency_buckets, m->latency_count, out);
+}
+
+void stream_metrics_display_age(StreamMetrics* m, gint64 age_us) {
+    observe(m->age_buckets, m->age_count, m->age_sum_us, std::max<gint64>(age_us, 0));
+}
+
+void stream_metrics_age(const StreamMetrics* m, LatencyHistogram& out) {
+    histogram(m->age_buckets, m->age_count, out);
+}
+
+double latency_quantile_ms(const LatencyHistogram& h, double q) {
+    if (!h.total) return -1.0;
+    double rank = q * (double)h.total;
+    guint64 below = 0;
+    for (int b = 0; b < kLatencyBuckets; ++b) {
+        if ((double)(below + h.counts[b]) >= rank && h.counts[b]) {
+            double lo = b ? kBucketMs[b - 1] : 0.0;
+            return lo + (kBucketMs[b] - lo) * (rank - (double)below) / (double)h.counts[b];
+        }
+        below += h.counts[b];
+    }
+    return kBucketMs[kLatencyBuckets - 1];  // above the largest bound: report the bound
+}
+
+// ---- Exposition ----
+
+static void appendf(std::string& out, const char* fmt, ...)
+#if defined(__GNUC__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+
+static void appendf(std::string& out, const char* fmt, ...) {
+    char buf[512];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = std::vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n > 0) out.append(buf, std::min((size_t)n, sizeof(buf) - 1));
+}
+
+static std::string label(const std::string& v) {
+    std::string s;
+    for (char c : v) {
+        if (c == '\\' || c == '"') s += '\\';
+        if (c == '\n') { s += "\\n"; continue; }
+        s += c;
+    }
+    return s;
+}
+
+static void header(std::string& out, const char* name, const char* type, const char* help) {
+    appendf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+typedef guint64 (*CounterGet)(const StreamMetrics*);
+
+static void per_stream(std::string& out, const std::vector<StreamMetrics*>& streams, const char* name,
+                       const char* type, const char* help, CounterGet get) {
+    header(out, name, type, help);
+    for (const StreamMetrics* m : streams) {
+        appendf(out, "%s{stream=\"%s\"} %" G_GUINT64_FORMAT "\n", name, label(m->name).c_str(), get(m));
+    }
+}
+
+static void histogram_lines(std::string& out, const char* name, const std::string& stream,
+                            const std::atomic<guint64>* buckets, const std::atomic<guint64>& count,
+                            const std::atomic<guint64>& sum_us) {
+    guint64 cum = 0;
+    for (int b = 0; b < kLatencyBuckets; ++b) {
+        cum += buckets[b].load();
+        appendf(out, "%s_bucket{stream=\"%s\",le=\"%.3f\"} %" G_GUINT64_FORMAT "\n", name, stream.c_str(),
+                kBucketMs[b] / 1000.0, cum);
+    }
+    const guint64 n = count.load();
+    appendf(out, "%s_bucket{stream=\"%s\",le=\"+Inf\"} %" G_GUINT64_FORMAT "\n", name, stream.c_str(), n);
+    appendf(out, "%s_sum{stream=\"%s\"} %.6f\n", name, stream.c_str(), sum_us.load() / 1e6);
+    appendf(out, "%s_count{stream=\"%s\"} %" G_GUINT64_FORMAT "\n", name, stream.c_str(), n);
+}
+
+std::string metrics_render() {
+    std::string out;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    const std::vector<StreamMetrics*>& s = registry;
+
+    per_stream(out, s, "grid_ingress_bytes_total", "counter", "RTP bytes leaving rtspsrc (bitrate: rate() * 8).",
+               [](const StreamMetrics* m) -> guint64 { return m->ingress_bytes.load(); });
+    per_stream(out, s, "grid_decoded_frames_total", "counter", "Frames out of the decoder.",
+               [](const StreamMetrics* m) -> guint64 { return m->decoded_frames.load(); });
+    per_stream(out, s, "grid_displayed_frames_total", "counter", "Frames reaching the sink (or the mosaic mixer).",
+               [](const StreamMetrics* m) -> guint64 { return m->displayed_frames.load(); });
+    per_stream(out, s, "grid_qos_dropped_total", "counter", "Frames dropped for QoS (late) by sink or decoder.",
+               [](const StreamMetrics* m) -> guint64 { return m->qos_dropped.load(); });
+    per_stream(out, s, "grid_reconnects_total", "counter", "Source swaps and pipeline rebuilds.",
+               [](const StreamMetrics* m) -> guint64 { return m->reconnects.load(); });
+    per_stream(out, s, "grid_mailbox_dropped_total", "counter",
+               "Frames replaced by a newer one before the render loop took them.",
+               [](const StreamMetrics* m) -> guint64 { return m->mailbox_dropped.load(); });
+    per_stream(out, s, "grid_zero_copy_frames_total", "counter",
+               "Frames scanned out from the buffer the decoder (or converter) wrote, without a CPU copy.",
+               [](const StreamMetrics* m) -> guint64 { return m->zero_copy_frames.load(); });
+    header(out, "grid_frame_copies_total", "counter",
+           "CPU passes over decoded frames: convert (videoconvert/videoscale at work), display (copy to scanout).");
+    for (const StreamMetrics* m : s) {
+        const std::string nm = label(m->name);
+        appendf(out, "grid_frame_copies_total{stream=\"%s\",stage=\"convert\"} %" G_GUINT64_FORMAT "\n", nm.c_str(),
+                m->convert_copies.load());
+        appendf(out, "grid_frame_copies_total{stream=\"%s\",stage=\"display\"} %" G_GUINT64_FORMAT "\n", nm.c_str(),
+                m->display_copies.load());
+    }
+
+    header(out, "grid_arrival_jitter_seconds", "gauge", "Smoothed deviation of frame arrival from the PTS spacing.");
+    for (const StreamMetrics* m : s) {
+        appendf(out, "grid_arrival_jitter_seconds{stream=\"%s\"} %.6f\n", label(m->name).c_str(),
+                m->jitter_us.load() / 1e6);
+    }
+
+    header(out, "grid_frame_latency_seconds", "histogram", "Time from rtspsrc output to the sink, per frame.");
+    for (const StreamMetrics* m : s) {
+        histogram_lines(out, "grid_frame_latency_seconds", label(m->name), m->latency_buckets, m->latency_count,
+                        m->latency_sum_us);
+    }
+    // Only the builds with a render loop compose frames themselves
+    header(out, "grid_display_age_seconds", "histogram",
+           "Age of each new frame when the render loop composed it (mailbox -> screen).");
+    for (const StreamMetrics* m : s) {
+        if (!m->age_count.load()) continue;
+        histogram_lines(out, "grid_display_age_seconds", label(m->name), m->age_buckets, m->age_count, m->age_sum_us);
+    }
+
+    header(out, "grid_stream_state", "gauge", "Lifecycle phase of the stream (1 for the current one).");
+    for (const StreamMetrics* m : s) {
+        const std::string nm = label(m->name);
+        const int cur = (int)stream_state_phase(&m->state);
+        for (int p = 0; p < kStreamPhases; ++p) {
+            appendf(out, "grid_stream_state{stream=\"%s\",state=\"%s\"} %d\n", nm.c_str(),
+                    stream_phase_name((StreamPhase)p), p == cur ? 1 : 0);
+        }
+    }
+    header(out, "grid_stream_state_entries_total", "counter", "Times the stream entered each lifecycle phase.");
+    for (const StreamMetrics* m : s) {
+        const std::string nm = label(m->name);
+        for (int p = 0; p < kStreamPhases; ++p) {
+            appendf(out, "grid_stream_state_entries_total{stream=\"%s\",state=\"%s\"} %" G_GUINT64_FORMAT "\n",
+                    nm.c_str(), stream_phase_name((StreamPhase)p), m->state.entries[p].load());
+        }
+    }
+    header(out, "grid_startup_phase_seconds", "gauge",
+           "Phase durations of the last connect attempt that reached Playing (-1: not observed).");
+    for (const StreamMetrics* m : s) {
+        const std::string nm = label(m->name);
+        for (int i = 0; i < kStartupSpans; ++i) {
+            gint64 us = m->state.spans_us[i].load();
+            appendf(out, "grid_startup_phase_seconds{stream=\"%s\",phase=\"%s\"} %.3f\n", nm.c_str(),
+                    startup_span_name(i), us < 0 ? -1.0 : us / 1e6);
+        }
+    }
+
+    std::vector<WarningCount> warnings;
+    warning_agg_snapshot(warnings);
+    header(out, "grid_warnings_total", "counter", "GStreamer WARNING messages by source element and error.");
+    for (const WarningCount& w : warnings) {
+        appendf(out, "grid_warnings_total{stream=\"%s\",source=\"%s\",domain=\"%s\",code=\"%d\"} %" G_GUINT64_FORMAT "\n",
+                label(w.stream).c_str(), label(w.source).c_str(), label(w.domain).c_str(), w.code, w.count);
+    }
+
+    header(out, "grid_log_dropped_total", "counter", "Log messages dropped because a log ring was full.");
+    appendf(out, "grid_log_dropped_total %llu\n", (unsigned long long)grid_log_dropped());
+
+#ifdef __linux__
+    ProcSample p;
+    if (proc_sample(p)) {
+        header(out, "grid_process_cpu_seconds_total", "counter", "User + system CPU time of the viewer.");
+        appendf(out, "grid_process_cpu_seconds_total %.2f\n", p.cpu_s);
+        header(out, "grid_process_resident_memory_bytes", "gauge", "Resident set size.");
+        appendf(out, "grid_process_resident_memory_bytes %ld\n", p.rss_kb * 1024);
+        header(out, "grid_process_threads", "gauge", "Threads in the process.");
+        appendf(out, "grid_process_threads %d\n", p.threads);
+    }
+#endif
+    return out;
+}
+
+// ---- HTTP endpoint ----
+
+// Minimal HTTP/1.0: read the request head, answer GET /metrics (or /), close.
+static gboolean on_incoming(GSocketService* /*service*/, GSocketConnection* conn, GObject* /*source*/,
+                            gpointer /*user_data*/) {
+    g_socket_set_timeout(g_socket_connection_get_socket(conn), 2);
+    GInputStream* in = g_io_stream_get_input_stream(G_IO_STREAM(conn));
+    char req[2048];
+    gsize total = 0;
+    req[0] = '\0';
+    while (total < sizeof(req) - 1) {
+        gssize n = g_input_stream_read(in, req + total, sizeof(req) - 1 - total, nullptr, nullptr);
+        if (n <= 0) break;
+        total += (gsize)n;
+        req[total] = '\0';
+        if (std::strstr(req, "\r\n\r\n") || std::strstr(req, "\n\n")) break;
+    }
+
+    bool found = std::strncmp(req, "GET /metrics", 12) == 0 || std::strncmp(req, "GET / ", 6) == 0;
+    std::string body = found ? metrics_render() : std::string("not found\n");
+    gchar* head = g_strdup_printf("HTTP/1.0 %s\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                  "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                                  found ? "200 OK" : "404 Not Found", body.size());
+    GOutputStream* out = g_io_stream_get_output_stream(G_IO_STREAM(conn));
+    g_output_stream_write_all(out, head, std::strlen(head), nullptr, nullptr, nullptr);
+    g_output_stream_write_all(out, body.data(), body.size(), nullptr, nullptr, nullptr);
+    g_free(head);
+    g_io_stream_close(G_IO_STREAM(conn), nullptr, nullptr);
+    return TRUE;
+}
+
+static GSocketAddress* parse_address(const std::string& spec) {
+    if (spec.compare(0, 5, "unix:") == 0) {
+#ifdef G_OS_UNIX
+        std::string path = spec.substr(5);
+        unlink(path.c_str());  // stale socket from an earlier run
+        return g_unix_socket_address_new(path.c_str());
+#else
+        return nullptr;
+#endif
+    }
+    std::string host = "127.0.0.1";
+    std::string port = spec;
+    size_t colon = spec.rfind(':');
+    if (colon != std::string::npos) {
+        host = spec.substr(0, colon);
+        port = spec.substr(colon + 1);
+    }
+    int p = std::atoi(port.c_str());
+    if (p <= 0 || p > 65535) return nullptr;
+    return g_inet_socket_address_new_from_string(host.c_str(), (guint)p);
+}
+
+// Own GMainContext: the Win32 message loop and the bus-thread builds do not run a GLib main loop.
+static void server_thread(std::string spec) {
+    GMainContext* ctx = g_main_context_new();
+    g_main_context_push_thread_default(ctx);
+
+    GSocketAddress* addr = parse_address(spec);
+    GSocketService* service = g_socket_service_new();
+    GError* err = nullptr;
+    if (!addr || !g_socket_listener_add_address(G_SOCKET_LISTENER(service), addr, G_SOCKET_TYPE_STREAM,
+                                                G_SOCKET_PROTOCOL_DEFAULT, nullptr, nullptr, &err)) {
+        g_printerr("[metrics] Cannot listen on %s: %s\n", spec.c_str(), err ? err->message : "bad address");
+        if (err) g_error_free(err);
+        if (addr) g_object_unref(addr);
+        g_object_unref(service);
+        g_main_context_pop_thread_default(ctx);
+        g_main_context_unref(ctx);
+        return;
+    }
+    g_object_unref(addr);
+    g_signal_connect(service, "incoming", G_CALLBACK(on_incoming), nullptr);
+    g_socket_service_start(service);
+    g_print("[metrics] Prometheus endpoint on %s/metrics\n", spec.c_str());
+
+    GMainLoop* loop = g_main_loop_new(ctx, FALSE);
+    g_main_loop_run(loop);  // runs for the life of the process
+    g_main_loop_unref(loop);
+}
+
+bool metrics_server_start() {
+    const char* env = std::getenv("GRID_METRICS");
+    if (!env || !*env) return false;
+    std::thread(server_thread, std::string(env)).detach();
+    return true;
+}
@@ -0,0 +1,112 @@
+// metrics.h
+// Per-stream runtime counters and a Prometheus text endpoint.
+//
+// Pad probes count what passes three points of a camera's pipeline:
+//   rtspsrc src pad  -> ingress bytes, frame arrival time (keyed by PTS), arrival jitter
+//   decoder src pad  -> decoded frames
+//   sink pad         -> displayed frames, per-frame latency rtspsrc -> sink (histogram)
+// plus QoS drops (QOS bus messages) and reconnects. Everything is a relaxed atomic bumped from the
+// streaming threads; nothing is formatted until a scrape. The same probes (and rtspsrc "on-sdp")
+// step the stream's lifecycle state machine (stream_state.h) through a connect attempt.
+//
+// $GRID_METRICS enables the endpoint: "9464" (127.0.0.1:9464), "0.0.0.0:9464", or on Linux
+// "unix:/run/grid-metrics.sock". Served by its own thread, so it works with every main loop.
+#pragma once
+
+#include <gst/gst.h>
+
+#include <atomic>
+#include <string>
+
+#include "stream_state.h"
+
+static const int kLatencyBuckets = 12;
+
+struct FrameStamp {
+    std::atomic<guint64> pts {GST_CLOCK_TIME_NONE};
+    std::atomic<gint64> arrival_us {0};
+};
+
+struct StreamMetrics {
+    std::string name;
+
+    std::atomic<guint64> ingress_bytes {0};
+    std::atomic<guint64> decoded_frames {0};
+    std::atomic<guint64> displayed_frames {0};
+    std::atomic<guint64> qos_dropped {0};
+    std::atomic<guint64> reconnects {0};
+    std::atomic<gint64> jitter_us {0};
+
+    std::atomic<guint64> latency_buckets[kLatencyBuckets] {};  // cumulative at scrape time
+    std::atomic<guint64> latency_count {0};
+    std::atomic<guint64> latency_sum_us {0};
+
+    // Render loop (frame_mailbox.h): age of each new frame when composed, frames replaced unseen
+    std::atomic<guint64> age_buckets[kLatencyBuckets] {};
+    std::atomic<guint64> age_count {0};
+    std::atomic<guint64> age_sum_us {0};
+    std::atomic<guint64> mailbox_dropped {0};
+
+    // CPU passes over a decoded frame on its way to the screen: converters not in passthrough
+    // (convert_chain.h, the DRM grid's tile sink), copies into a scanout buffer (drm_grid.h), and
+    // frames the display scanned out of the decoder's own buffer
+    std::atomic<guint64> convert_copies {0};
+    std::atomic<guint64> display_copies {0};
+    std::atomic<guint64> zero_copy_frames {0};
+
+    StreamLifecycle state;  // Connecting/Stalled/Backoff/Idle are set by the builder
+
+    // Data-flow watchdog (watchdog.h)
+    std::atomic<gint64> last_buffer_us {0};   // stamped by the ingress probe
+    GWeakRef source {};                       // current rtspsrc
+    bool stall_watch {true};                  // false: the builder has its own deadline (mosaic)
+    guint64 stall_fired_attempt {0};          // wheel thread only
+
+    // Ingress thread only
+    guint64 last_pts {GST_CLOCK_TIME_NONE};
+    gint64 last_arrival_us {0};
+    double jitter {0.0};
+    FrameStamp stamps[128];
+    std::atomic<unsigned> stamp_pos {0};
+
+    ~StreamMetrics();
+};
+
+// Registers `m` for the endpoint under `name` (one per camera).
+void stream_metrics_init(StreamMetrics* m, const std::string& name);
+
+// rtspsrc itself, for the DESCRIBE answer and the data-flow watchdog (every new rtspsrc,
+// including a swapped one).
+void stream_metrics_watch_source(StreamMetrics* m, GstElement* rtspsrc);
+// rtspsrc video pad (called by decode_chain_link_pad for every new source pad).
+void stream_metrics_watch_ingress(StreamMetrics* m, GstPad* pad);
+void stream_metrics_watch_decoder(StreamMetrics* m, GstElement* dec);
+// Display point: the sink's "sink" pad, or the pad that feeds a mosaic tile into the mixer.
+void stream_metrics_watch_sink(StreamMetrics* m, GstElement* sink);
+void stream_metrics_watch_display(StreamMetrics* m, GstPad* pad);
+
+// GST_MESSAGE_QOS from a sink or decoder: one dropped frame.
+void stream_metrics_qos(StreamMetrics* m);
+void stream_metrics_reconnect(StreamMetrics* m);
+
+// Per-bucket (not cumulative) latency counts; the last slot holds frames above the largest bound.
+struct LatencyHistogram {
+    guint64 counts[kLatencyBuckets + 1] {};
+    guint64 total {0};
+};
+
+void stream_metrics_latency(const StreamMetrics* m, LatencyHistogram& out);
+
+// Render loop: a new frame of the stream was composed `age_us` after it reached the mailbox.
+void stream_metrics_display_age(StreamMetrics* m, gint64 age_us);
+void stream_metrics_age(const StreamMetrics* m, LatencyHistogram& out);
+// Quantile `q` (0..1) in milliseconds, interpolated within the bucket like Prometheus'
+// histogram_quantile(); -1 for an empty histogram.
+double latency_quantile_ms(const LatencyHistogram& h, double q);
+
+// All registered streams (plus warning, log and process counters) in Prometheus text format.
+std::string metrics_render();
+
+// Starts the endpoint from $GRID_METRICS; false when unset. A bad or busy address is logged
+// by the endpoint thread as "[metrics] Cannot listen on ...".
+bool metrics_server_start();
@@ -0,0 +1,489 @@
+// mosaic.cpp
+#include "mosaic.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "bus_dispatch.h"
+
+static gboolean pad_has_video_caps(GstPad* pad) {
+    GstCaps* caps = gst_pad_get_current_caps(pad);
+    if (!caps) caps = gst_pad_query_caps(pad, nullptr);
+    gboolean is_video = FALSE;
+    if (caps) {
+        const GstStructure* st = gst_caps_get_structure(caps, 0);
+        const gchar* name = gst_structure_get_name(st);
+        if (g_str_has_prefix(name, "video/") ||
+            (g_str_has_prefix(name, "application/x-rtp") &&
+             g_strcmp0(gst_structure_get_string(st, "media"), "video") == 0)) {
+            is_video = TRUE;
+        }
+        gst_caps_unref(caps);
+    }
+    return is_video;
+}
+
+static GstPad* request_mixer_pad(GstElement* mixer) {
+#if GST_CHECK_VERSION(1, 20, 0)
+    return gst_element_request_pad_simple(mixer, "sink_%u");
+#else
+    return gst_element_get_request_pad(mixer, "sink_%u");
+#endif
+}
+
+static int env_int(const char* name, int fallback) {
+    const char* env = std::getenv(name);
+    if (!env || !*env) return fallback;
+    return std::atoi(env);
+}
+
+static void set_if_supported(gpointer obj, const char* prop, gboolean value) {
+    if (g_object_class_find_property(G_OBJECT_GET_CLASS(obj), prop)) {
+        g_object_set(G_OBJECT(obj), prop, value, NULL);
+    }
+}
+
+bool mosaic_use_gl() {
+    const char* env = std::getenv("GRID_MIXER");
+    return env && g_ascii_strcasecmp(env, "gl") == 0;
+}
+
+static void on_tile_src_pad_added(GstElement* /*src*/, GstPad* pad, gpointer user_data) {
+    MosaicTile* t = static_cast<MosaicTile*>(user_data);
+    if (!pad_has_video_caps(pad)) return;
+    decode_chain_link_pad(&t->dc, GST_BIN(t->bin), pad, t->queue);
+}
+
+// Streaming thread: stamp every frame for the deadline check, and keep EOS away from the mixer
+// pad so it never goes EOS and keeps repeating the tile's last frame while the tile is rebuilt.
+static GstPadProbeReturn on_tile_output(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+    MosaicTile* t = static_cast<MosaicTile*>(user_data);
+    if (GST_PAD_PROBE_INFO_TYPE(info) & GST_PAD_PROBE_TYPE_BUFFER) {
+        t->last_buffer_us.store(g_get_monotonic_time(), std::memory_order_relaxed);
+        t->frames.fetch_add(1, std::memory_order_relaxed);
+        return GST_PAD_PROBE_OK;
+    }
+    GstEvent* ev = GST_PAD_PROBE_INFO_EVENT(info);
+    if (ev && GST_EVENT_TYPE(ev) == GST_EVENT_EOS) {
+        t->eos.store(true);
+        return GST_PAD_PROBE_DROP;
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+// One camera as a self-contained bin with a ghost "src" pad already scaled to the tile size,
+// so the mixer only blends and every tile scales in its own streaming thread.
+static bool build_tile_bin(MosaicTile* t, bool gl) {
+    t->bin    = gst_bin_new((t->name + "_bin").c_str());
+    if (t->bin) decode_gate_watch_parsers(&t->gate, t->bin);
+    t->src    = gst_element_factory_make("rtspsrc", (t->name + "_src").c_str());
+    t->queue  = gst_element_factory_make("queue", (t->name + "_q").c_str());
+    t->scale  = gst_element_factory_make("videoscale", (t->name + "_scale").c_str());
+    t->capsf  = gst_element_factory_make("capsfilter", (t->name + "_caps").c_str());
+    if (!t->bin || !t->src || !t->queue || !t->scale || !t->capsf) {
+        g_printerr("[%s] Failed to create mosaic tile elements\n", t->name.c_str());
+        return false;
+    }
+
+    g_object_set(G_OBJECT(t->src), "location", t->url.c_str(), "latency", 200, NULL);
+    g_object_set(G_OBJECT(t->queue),
+        "leaky", 2, /* downstream */
+        "max-size-buffers", 2,
+        "max-size-bytes", 0,
+        "max-size-time", G_GUINT64_CONSTANT(0),
+        NULL);
+
+    // glvideomixer scales on the GPU, so the tile only needs to be downscaled for the CPU mixer
+    if (!gl) {
+        GstCaps* caps = gst_caps_new_simple("video/x-raw",
+            "width", G_TYPE_INT, t->rect.w,
+            "height", G_TYPE_INT, t->rect.h,
+            "pixel-aspect-ratio", GST_TYPE_FRACTION, 1, 1,
+            NULL);
+        g_object_set(G_OBJECT(t->capsf), "caps", caps, NULL);
+        gst_caps_unref(caps);
+    }
+
+    gst_bin_add_many(GST_BIN(t->bin), t->src, t->queue, t->scale, t->capsf, NULL);
+    if (!gst_element_link_many(t->queue, t->scale, t->capsf, NULL)) {
+        g_printerr("[%s] Failed to link queue->scale->caps\n", t->name.c_str());
+        return false;
+    }
+    decode_chain_prebuild(&t->dc, GST_BIN(t->bin), t->queue);
+
+    GstPad* out = gst_element_get_static_pad(t->capsf, "src");
+    GstPad* ghost = gst_ghost_pad_new("src", out);
+    gst_object_unref(out);
+    gst_pad_set_active(ghost, TRUE);
+    t->output_probe = gst_pad_add_probe(ghost,
+        (GstPadProbeType)(GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM),
+        on_tile_output, t, nullptr);
+    stream_metrics_watch_display(&t->metrics, ghost);
+    gst_element_add_pad(t->bin, ghost);
+
+    g_signal_connect(t->src, "pad-added", G_CALLBACK(on_tile_src_pad_added), t);
+    t->metrics.stall_watch = false;  // the tile deadline ($GRID_TILE_DEADLINE_MS) covers a silent camera
+    stream_metrics_watch_source(&t->metrics, t->src);
+
+    t->eos = false;
+    t->started_us = g_get_monotonic_time();
+    stream_state_enter(&t->metrics.state, StreamPhase::Connecting);
+    t->last_buffer_us = 0;
+    return true;
+}
+
+// Adds a freshly built tile bin to the running pipeline on its (existing) mixer pad.
+static bool attach_tile(Mosaic* m, MosaicTile* t) {
+    if (!build_tile_bin(t, m->gl)) return false;
+    gst_bin_add(GST_BIN(m->pipeline), t->bin);
+    GstPad* out = gst_element_get_static_pad(t->bin, "src");
+    GstPadLinkReturn ret = gst_pad_link(out, t->mixer_pad);
+    gst_object_unref(out);
+    if (ret != GST_PAD_LINK_OK) {
+        g_printerr("[%s] Failed to link tile to mixer: %d\n", t->name.c_str(), ret);
+        return false;
+    }
+    return true;
+}
+
+// Removes the tile bin but keeps its mixer pad, which keeps showing the last frame. The bin is
+// unlinked and taken out of the pipeline here, and set to NULL on the disposal pool: rtspsrc's
+// TEARDOWN to a dead camera would otherwise block the main loop (and every other tile's checks).
+static void detach_tile(Mosaic* m, MosaicTile* t) {
+    if (!t->bin) return;
+    GstElement* old = t->bin;
+    GstPad* out = gst_element_get_static_pad(old, "src");
+    if (out) {
+        // Frames the old bin still pushes until it is down must not count for the new one
+        if (t->output_probe) gst_pad_remove_probe(out, t->output_probe);
+        gst_pad_unlink(out, t->mixer_pad);
+        gst_object_unref(out);
+    }
+    // The old rtspsrc keeps running until the pool stops it (often mid-DESCRIBE): a late pad-added
+    // must not link into the rebuilt tile, or into no bin at all
+    if (t->src) g_signal_handlers_disconnect_by_data(t->src, t);
+    gst_object_ref(old);
+    gst_bin_remove(GST_BIN(m->pipeline), old);
+    t->bin = t->src = t->queue = t->scale = t->capsf = nullptr;
+    t->output_probe = 0;
+    decode_chain_reset(&t->dc);
+    bus_dispatch_dispose(old);
+}
+
+static gboolean tile_restart_cb(gpointer user_data);
+
+// A tile whose bin could not be built or started: try again on its backoff.
+static void retry_tile_rebuild(MosaicTile* t) {
+    int delay_ms = backoff_next(&t->backoff, FailureKind::Network);
+    stream_state_enter(&t->metrics.state, StreamPhase::Backoff);
+    g_printerr("[%s] Tile rebuild failed: %s\n", t->name.c_str(), backoff_describe(&t->backoff).c_str());
+    t->restart_id = g_timeout_add((guint)delay_ms, tile_restart_cb, t);
+}
+
+static gboolean tile_restart_cb(gpointer user_data) {
+    MosaicTile* t = static_cast<MosaicTile*>(user_data);
+    Mosaic* m = t->owner;
+    t->restart_id = 0;
+    if (!m->pipeline) return G_SOURCE_REMOVE;
+
+    detach_tile(m, t);
+    if (!attach_tile(m, t) || !gst_element_sync_state_with_parent(t->bin)) {
+        retry_tile_rebuild(t);
+    } else {
+        g_print("[%s] Tile restarted\n", t->name.c_str());
+    }
+    return G_SOURCE_REMOVE;
+}
+
+static void schedule_tile_restart(MosaicTile* t, const char* why, FailureKind kind) {
+    if (t->restart_id) return;
+    stream_state_enter(&t->metrics.state, StreamPhase::Stalled);
+    int delay_ms = backoff_next(&t->backoff, kind);
+    stream_state_enter(&t->metrics.state, StreamPhase::Backoff);
+    g_printerr("[%s] %s; rebuilding tile: %s\n", t->name.c_str(), why, backoff_describe(&t->backoff).c_str());
+    stream_metrics_reconnect(&t->metrics);
+    t->restart_id = g_timeout_add((guint)delay_ms, tile_restart_cb, t);
+}
+
+static MosaicTile* tile_for_object(Mosaic* m, GstObject* obj) {
+    for (auto& t : m->tiles) {
+        if (t->bin && (obj == GST_OBJECT(t->bin) || gst_object_has_as_ancestor(obj, GST_OBJECT(t->bin)))) {
+            return t.get();
+        }
+    }
+    return nullptr;
+}
+
+// Main loop, every 500ms: restart tiles that hit EOS or missed their deadline, reset the backoff
+// of tiles that are flowing, and print per-tile fps when $GRID_STATS is set.
+static gboolean mosaic_check_cb(gpointer user_data) {
+    Mosaic* m = static_cast<Mosaic*>(user_data);
+    gint64 now = g_get_monotonic_time();
+    for (auto& tp : m->tiles) {
+        MosaicTile* t = tp.get();
+        if (t->restart_id || !t->bin) continue;
+        gint64 last = t->last_buffer_us.load(std::memory_order_relaxed);
+        // Hidden, or visible again but waiting for its keyframe: the gate holds frames back on
+        // purpose, so the camera is judged by what rtspsrc still receives
+        if (t->gate.hidden.load() || t->gate.wait_keyframe.load()) {
+            last = std::max(last, t->metrics.last_buffer_us.load(std::memory_order_relaxed));
+        }
+        if (t->eos.load()) {
+            schedule_tile_restart(t, "EOS", FailureKind::Eos);
+        } else if (now - std::max(last, t->started_us) > m->tile_deadline_us) {
+            schedule_tile_restart(t, last ? "No frames within deadline" : "No first frame within deadline",
+                                  FailureKind::Network);
+        } else if (last) {
+            backoff_success(&t->backoff);
+        }
+    }
+
+    for (auto& t : m->tiles) {
+        decode_chain_commit(&t->dc);
+        warning_agg_tick(&t->warnings);
+    }
+    warning_agg_tick(&m->warnings);
+
+    if (m->report_every_s && now - m->last_report_us >= (gint64)m->report_every_s * G_USEC_PER_SEC) {
+        double dt = (now - m->last_report_us) / (double)G_USEC_PER_SEC;
+        GString* line = g_string_new("[mosaic] fps:");
+        for (auto& t : m->tiles) {
+            guint64 frames = t->frames.load(std::memory_order_relaxed);
+            g_string_append_printf(line, " %s=%.1f", t->name.c_str(), (frames - t->frames_reported) / dt);
+            t->frames_reported = frames;
+        }
+        g_printerr("%s\n", line->str);
+        g_string_free(line, TRUE);
+        m->last_report_us = now;
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+bool mosaic_build(Mosaic* m, const std::vector<CameraConfig>& cams, const GridLayout& layout,
+                  int width, int height, bool gl, GstElement* sink) {
+    m->width = width;
+    m->height = height;
+    m->gl = gl;
+    m->sink = sink;
+    m->tile_deadline_us = (gint64)env_int("GRID_TILE_DEADLINE_MS", 3000) * 1000;
+    m->report_every_s = env_int("GRID_STATS", 0);
+    warning_agg_init(&m->warnings, "mosaic");
+    backoff_init(&m->backoff, "mosaic");
+
+    m->pipeline = gst_pipeline_new("mosaic_pipe");
+    m->mixer    = gst_element_factory_make(gl ? "glvideomixer" : "compositor", "mosaic_mixer");
+    m->capsf    = gst_element_factory_make("capsfilter", "mosaic_caps");
+    m->background      = gst_element_factory_make("videotestsrc", "mosaic_bg");
+    m->background_caps = gst_element_factory_make("capsfilter", "mosaic_bg_caps");
+    if (!gl) m->conv = gst_element_factory_make("videoconvert", "mosaic_conv");
+    if (!m->pipeline || !m->mixer || !m->capsf || !m->background || !m->background_caps ||
+        (!gl && !m->conv) || !m->sink) {
+        g_printerr("[mosaic] Failed to create %s/capsfilter/videotestsrc/sink\n", gl ? "glvideomixer" : "compositor");
+        return false;
+    }
+
+    // Wait at most GRID_MIXER_LATENCY_MS for a late tile before emitting the frame without it,
+    // and don't wait at all for tiles that never produced anything yet (still connecting).
+    g_object_set(G_OBJECT(m->mixer),
+        "background", 1 /* black */,
+        "latency", (guint64)env_int("GRID_MIXER_LATENCY_MS", 50) * GST_MSECOND,
+        NULL);
+    set_if_supported(m->mixer, "ignore-inactive-pads", TRUE);
+
+    GstCaps* caps = gst_caps_new_simple("video/x-raw",
+        "width", G_TYPE_INT, width,
+        "height", G_TYPE_INT, height,
+        "pixel-aspect-ratio", GST_TYPE_FRACTION, 1, 1,
+        NULL);
+    if (gl) {
+        gst_caps_set_features(caps, 0, gst_caps_features_new("memory:GLMemory", NULL));
+    }
+    g_object_set(G_OBJECT(m->capsf), "caps", caps, NULL);
+    gst_caps_unref(caps);
+
+    // Tiny live source on an invisible pad: drives the output at a steady rate even when every
+    // camera is down. The mixer's own black background does the painting.
+    g_object_set(G_OBJECT(m->background), "is-live", TRUE, "pattern", 2 /* black */, NULL);
+    GstCaps* bg_caps = gst_caps_new_simple("video/x-raw",
+        "width", G_TYPE_INT, 16,
+        "height", G_TYPE_INT, 16,
+        "framerate", GST_TYPE_FRACTION, env_int("GRID_MOSAIC_FPS", 25), 1,
+        NULL);
+    g_object_set(G_OBJECT(m->background_caps), "caps", bg_caps, NULL);
+    gst_caps_unref(bg_caps);
+
+    g_object_set(G_OBJECT(m->sink), "sync", FALSE, "qos", TRUE, NULL);
+
+    gst_bin_add_many(GST_BIN(m->pipeline), m->mixer, m->capsf, m->sink, m->background, m->background_caps, NULL);
+    if (m->conv) gst_bin_add(GST_BIN(m->pipeline), m->conv);
+    gboolean linked = m->conv
+        ? gst_element_link_many(m->mixer, m->capsf, m->conv, m->sink, NULL)
+        : gst_element_link_many(m->mixer, m->capsf, m->sink, NULL);
+    if (!linked || !gst_element_link(m->background, m->background_caps)) {
+        g_printerr("[mosaic] Failed to link mixer->caps->sink\n");
+        return false;
+    }
+    backoff_watch(&m->backoff, m->sink);
+
+    m->background_pad = request_mixer_pad(m->mixer);
+    g_object_set(G_OBJECT(m->background_pad), "zorder", 0, "alpha", 0.0, NULL);
+    GstPad* bg_out = gst_element_get_static_pad(m->background_caps, "src");
+    GstPadLinkReturn bg_ret = gst_pad_link(bg_out, m->background_pad);
+    gst_object_unref(bg_out);
+    if (bg_ret != GST_PAD_LINK_OK) {
+        g_printerr("[mosaic] Failed to link background to mixer: %d\n", bg_ret);
+        return false;
+    }
+
+    for (size_t i = 0; i < cams.size(); ++i) {
+        auto t = std::make_unique<MosaicTile>();
+        t->owner = m;
+        t->name = cams[i].name;
+        t->rect = grid_tile(layout, (int)i, width, height);
+        t->url  = camera_url_for(cams[i], t->rect.w, t->rect.h);
+        decode_chain_init(&t->dc, t->name, t->url, false);
+        warning_agg_init(&t->warnings, t->name);
+        t->gate.name = t->name;
+        stream_metrics_init(&t->metrics, t->name);
+        backoff_init(&t->backoff, t->name);
+        t->dc.metrics = &t->metrics;
+
+        // Last-frame hold: repeat the tile's newest frame for as long as it is silent
+        // (GRID_TILE_HOLD_MS limits it; the tile then shows the background).
+        t->mixer_pad = request_mixer_pad(m->mixer);
+        int hold_ms = env_int("GRID_TILE_HOLD_MS", -1);
+        g_object_set(G_OBJECT(t->mixer_pad),
+            "zorder", (guint)(i + 1),
+            "xpos", t->rect.x,
+            "ypos", t->rect.y,
+            "width", t->rect.w,
+            "height", t->rect.h,
+            NULL);
+        if (g_object_class_find_property(G_OBJECT_GET_CLASS(t->mixer_pad), "max-last-buffer-repeat")) {
+            g_object_set(G_OBJECT(t->mixer_pad), "max-last-buffer-repeat",
+                         hold_ms < 0 ? GST_CLOCK_TIME_NONE : (guint64)hold_ms * GST_MSECOND, NULL);
+        }
+
+        if (!attach_tile(m, t.get())) return false;
+        m->tiles.push_back(std::move(t));
+    }
+    return true;
+}
+
+static void schedule_mosaic_restart(Mosaic* m, const char* why, FailureKind kind);
+
+static gboolean mosaic_restart_cb(gpointer user_data) {
+    Mosaic* m = static_cast<Mosaic*>(user_data);
+    m->restart_id = 0;
+    if (!m->pipeline) return G_SOURCE_REMOVE;
+
+    // The tile bins go down on the disposal pool like a single tile rebuild (their TEARDOWNs would
+    // block here); what stays (background, mixer, sink) cycles through READY without the network.
+    // Fresh tile bins are added in NULL and come up with the pipeline.
+    for (auto& t : m->tiles) {
+        if (t->restart_id) { g_source_remove(t->restart_id); t->restart_id = 0; }
+        detach_tile(m, t.get());
+    }
+    gst_element_set_state(m->pipeline, GST_STATE_READY);
+    for (auto& t : m->tiles) {
+        if (!attach_tile(m, t.get())) retry_tile_rebuild(t.get());
+    }
+    if (gst_element_set_state(m->pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        schedule_mosaic_restart(m, "Restart failed", FailureKind::Network);
+    } else {
+        g_print("[mosaic] Restarted\n");
+    }
+    return G_SOURCE_REMOVE;
+}
+
+static void schedule_mosaic_restart(Mosaic* m, const char* why, FailureKind kind) {
+    if (m->restart_id) return;
+    int delay_ms = backoff_next(&m->backoff, kind);
+    g_printerr("[mosaic] %s; restarting: %s\n", why, backoff_describe(&m->backoff).c_str());
+    m->restart_id = g_timeout_add((guint)delay_ms, mosaic_restart_cb, m);
+}
+
+static gboolean on_mosaic_bus_msg(GstBus* /*bus*/, GstMessage* msg, gpointer user_data) {
+    Mosaic* m = static_cast<Mosaic*>(user_data);
+    switch (GST_MESSAGE_TYPE(msg)) {
+    case GST_MESSAGE_WARNING: {
+        MosaicTile* t = tile_for_object(m, GST_MESSAGE_SRC(msg));
+        warning_agg_add(t ? &t->warnings : &m->warnings, msg);
+        break;
+    }
+    case GST_MESSAGE_ERROR: {
+        GError* err = nullptr; gchar* dbg = nullptr;
+        gst_message_parse_error(msg, &err, &dbg);
+        g_printerr("[mosaic][ERROR] %s: %s | %s\n", GST_OBJECT_NAME(GST_MESSAGE_SRC(msg)),
+                   err?err->message:"", dbg?dbg:"");
+        if (err) g_error_free(err); if (dbg) g_free(dbg);
+
+        // A camera error only takes down its own tile; anything else restarts the whole wall
+        if (MosaicTile* t = tile_for_object(m, GST_MESSAGE_SRC(msg))) {
+            const bool from_decoder = decode_chain_is_decoder(&t->dc, GST_MESSAGE_SRC(msg));
+            if (from_decoder) decode_chain_mark_failed(&t->dc);
+            schedule_tile_restart(t, "Error", backoff_classify(msg, from_decoder));
+        } else {
+            schedule_mosaic_restart(m, "Error", backoff_classify(msg, false));
+        }
+        break;
+    }
+    case GST_MESSAGE_QOS:
+        // Drops in the mixer or sink are shared by every tile and not attributed to one
+        if (MosaicTile* t = tile_for_object(m, GST_MESSAGE_SRC(msg))) stream_metrics_qos(&t->metrics);
+        break;
+    case GST_MESSAGE_EOS:
+        // Tile EOS never reaches the mixer (see on_tile_output), so this is the whole pipeline
+        schedule_mosaic_restart(m, "EOS", FailureKind::Eos);
+        break;
+    default: break;
+    }
+    return TRUE;
+}
+
+bool mosaic_start(Mosaic* m) {
+    GstBus* bus = gst_element_get_bus(m->pipeline);
+    m->watch_id = gst_bus_add_watch(bus, on_mosaic_bus_msg, m);
+    gst_object_unref(bus);
+
+    if (gst_element_set_state(m->pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        g_printerr("[mosaic] Failed to set PLAYING\n");
+        return false;
+    }
+    gint64 now = g_get_monotonic_time();
+    for (auto& t : m->tiles) t->started_us = now;
+    m->last_report_us = now;
+    m->check_id = g_timeout_add(500, mosaic_check_cb, m);
+
+    g_print("[mosaic] %zu tiles -> %s %dx%d, tile deadline %" G_GINT64_FORMAT "ms\n", m->tiles.size(),
+            m->gl ? "glvideomixer" : "compositor", m->width, m->height, m->tile_deadline_us / 1000);
+    return true;
+}
+
+void mosaic_cleanup(Mosaic* m) {
+    if (m->restart_id) { g_source_remove(m->restart_id); m->restart_id = 0; }
+    if (m->check_id) { g_source_remove(m->check_id); m->check_id = 0; }
+    if (m->watch_id) { g_source_remove(m->watch_id); m->watch_id = 0; }
+    for (auto& t : m->tiles) {
+        if (t->restart_id) { g_source_remove(t->restart_id); t->restart_id = 0; }
+    }
+    if (m->pipeline) {
+        gst_element_set_state(m->pipeline, GST_STATE_NULL);
+        for (auto& t : m->tiles) {
+            if (t->mixer_pad) {
+                gst_element_release_request_pad(m->mixer, t->mixer_pad);
+                gst_object_unref(t->mixer_pad);
+                t->mixer_pad = nullptr;
+            }
+        }
+        if (m->background_pad) {
+            gst_element_release_request_pad(m->mixer, m->background_pad);
+            gst_object_unref(m->background_pad);
+            m->background_pad = nullptr;
+        }
+        gst_object_unref(m->pipeline);
+        m->pipeline = nullptr;
+    }
+    bus_dispatch_wait_disposed();  // detached tile bins still run probes on their MosaicTile
+    m->tiles.clear();
+}
@@ -0,0 +1,98 @@
+// mosaic.h
+// Single-pipeline mosaic: every camera branch feeds one compositor/glvideomixer and one sink.
+//
+//   videotestsrc(black, live) ------------------------------------------------> mixer.sink_0
+//   [bin camN: rtspsrc -> depay/parse/dec -> queue -> videoscale -> capsfilter] -> mixer.sink_N
+//   mixer -> capsfilter(WxH) [-> videoconvert] -> sink
+//
+// Stall isolation: the live background keeps the mixer producing frames on its own clock, the
+// mixer waits at most `latency` for late tiles, and each tile pad repeats its last frame. A tile
+// whose camera errors, sends EOS or goes silent past its deadline is torn down and rebuilt on its
+// own while the mixer pad (and its last frame) stays in place.
+#pragma once
+
+#include <gst/gst.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "backoff.h"
+#include "codec_chain.h"
+#include "metrics.h"
+#include "stream_set.h"
+#include "visibility.h"
+#include "warn_agg.h"
+
+struct Mosaic;
+
+struct MosaicTile {
+    Mosaic* owner {nullptr};
+    std::string name;
+    std::string url;
+    TileRect rect;
+
+    GstElement* bin {nullptr};
+    GstElement* src {nullptr};
+    DecodeChain dc;  // lives across tile rebuilds (remembers failed decoders)
+    WarningAggregator warnings;
+    StreamMetrics metrics;  // displayed = frames leaving the tile bin for the mixer
+    GstElement* queue {nullptr};
+    GstElement* scale {nullptr};
+    GstElement* capsf {nullptr};
+    GstPad* mixer_pad {nullptr};
+    gulong output_probe {0};  // on the bin's ghost src pad
+
+    // Written by the tile's streaming thread, read by the main-loop deadline check
+    std::atomic<gint64> last_buffer_us {0};
+    std::atomic<guint64> frames {0};
+    std::atomic<bool> eos {false};
+
+    gint64 started_us {0};
+    guint64 frames_reported {0};
+    guint restart_id {0};
+    ReconnectBackoff backoff;
+    // Per tile: after a hidden->visible switch each tile must resume from its own next keyframe
+    DecodeGate gate;
+};
+
+struct Mosaic {
+    int width {0};
+    int height {0};
+    bool gl {false};
+
+    GstElement* pipeline {nullptr};
+    GstElement* mixer {nullptr};
+    GstElement* capsf {nullptr};
+    GstElement* conv {nullptr};
+    GstElement* sink {nullptr};
+    GstElement* background {nullptr};
+    GstElement* background_caps {nullptr};
+    GstPad* background_pad {nullptr};
+    std::vector<std::unique_ptr<MosaicTile>> tiles;
+    WarningAggregator warnings;  // mixer, sink and other non-tile elements
+
+    gint64 tile_deadline_us {3 * G_USEC_PER_SEC}; // $GRID_TILE_DEADLINE_MS
+    gint64 last_report_us {0};
+    int report_every_s {0};                       // $GRID_STATS
+
+    guint watch_id {0};
+    guint check_id {0};
+    guint restart_id {0};
+    ReconnectBackoff backoff;                     // whole-wall restarts; reset by a frame at the sink
+};
+
+// $GRID_MIXER=gl selects glvideomixer (the sink must then accept GLMemory, e.g. gtkglsink);
+// anything else uses the CPU compositor.
+bool mosaic_use_gl();
+
+// Builds the whole mosaic into m->pipeline. `sink` is added to the pipeline and owned by it.
+bool mosaic_build(Mosaic* m, const std::vector<CameraConfig>& cams, const GridLayout& layout,
+                  int width, int height, bool gl, GstElement* sink);
+
+// Installs the bus watch and the per-tile deadline check on the default main context and sets
+// the pipeline to PLAYING.
+bool mosaic_start(Mosaic* m);
+
+void mosaic_cleanup(Mosaic* m);
@@ -0,0 +1,76 @@
+// proc_stats.cpp
+#include "proc_stats.h"
+
+#include <glib.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <unistd.h>
+
+static int count_fds() {
+    DIR* d = opendir("/proc/self/fd");
+    if (!d) return 0;
+    int n = 0;
+    while (struct dirent* e = readdir(d)) {
+        if (e->d_name[0] != '.') ++n;
+    }
+    closedir(d);
+    return n - 1; // the DIR itself
+}
+
+bool proc_sample(ProcSample& out) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    out.wall_s = ts.tv_sec + ts.tv_nsec / 1e9;
+
+    FILE* f = std::fopen("/proc/self/stat", "r");
+    if (!f) return false;
+    char buf[1024];
+    size_t n = std::fread(buf, 1, sizeof(buf) - 1, f);
+    std::fclose(f);
+    buf[n] = '\0';
+    // Fields after the "(comm)" which may itself contain spaces.
+    const char* p = std::strrchr(buf, ')');
+    if (!p) return false;
+    unsigned long utime = 0, stime = 0;
+    // state ppid pgrp session tty_nr tpgid flags minflt cminflt majflt cmajflt utime stime
+    if (std::sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2) {
+        return false;
+    }
+    out.cpu_s = (double)(utime + stime) / (double)sysconf(_SC_CLK_TCK);
+
+    f = std::fopen("/proc/self/status", "r");
+    if (!f) return false;
+    char line[256];
+    while (std::fgets(line, sizeof(line), f)) {
+        if (std::strncmp(line, "VmRSS:", 6) == 0) out.rss_kb = std::strtol(line + 6, nullptr, 10);
+        else if (std::strncmp(line, "Threads:", 8) == 0) out.threads = (int)std::strtol(line + 8, nullptr, 10);
+    }
+    std::fclose(f);
+
+    out.fds = count_fds();
+    return true;
+}
+
+void proc_report(ProcSample& prev, size_t streams) {
+    ProcSample now;
+    if (!proc_sample(now)) return;
+    double dt = now.wall_s - prev.wall_s;
+    double cpu = dt > 0 ? 100.0 * (now.cpu_s - prev.cpu_s) / dt : 0.0;
+    double n = streams ? (double)streams : 1.0;
+    g_printerr(
+        "[stats] streams=%zu cpu=%.1f%% rss=%.1fMB threads=%d fds=%d | per-stream cpu=%.1f%% rss=%.1fMB threads=%.1f\n",
+        streams, cpu, now.rss_kb / 1024.0, now.threads, now.fds,
+        cpu / n, now.rss_kb / 1024.0 / n, now.threads / n);
+    prev = now;
+}
+
+int proc_stats_interval() {
+    const char* env = std::getenv("GRID_STATS");
+    if (!env || !*env) return 0;
+    int s = std::atoi(env);
+    return s > 0 ? s : 0;
+}
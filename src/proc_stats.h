@@ -0,0 +1,22 @@
+// proc_stats.h
+// Process resource sampling from /proc (Linux only), used to build the per-stream scaling curve.
+#pragma once
+
+#include <cstddef>
+
+struct ProcSample {
+    double wall_s {0.0};      // monotonic clock, seconds
+    double cpu_s {0.0};       // utime + stime, seconds
+    long rss_kb {0};
+    int threads {0};
+    int fds {0};
+};
+
+bool proc_sample(ProcSample& out);
+
+// Prints one "[stats]" line: CPU% since `prev` (100% = one core), RSS, threads, fds and the
+// same numbers divided by the number of streams. Updates `prev` to the new sample.
+void proc_report(ProcSample& prev, size_t streams);
+
+// Seconds between reports from $GRID_STATS, 0 (disabled) when unset.
+int proc_stats_interval();
@@ -0,0 +1,112 @@
+// render_loop_gtk.cpp
+#include "render_loop_gtk.h"
+
+#include <gst/video/video.h>
+
+static void paint_sample(cairo_t* cr, GstSample* sample, const TileRect& t) {
+    GstVideoInfo info;
+    GstCaps* caps = gst_sample_get_caps(sample);
+    GstBuffer* buf = gst_sample_get_buffer(sample);
+    if (!caps || !buf || !gst_video_info_from_caps(&info, caps)) return;
+    GstVideoFrame frame;
+    if (!gst_video_frame_map(&frame, &info, buf, GST_MAP_READ)) return;
+
+    const int w = GST_VIDEO_FRAME_WIDTH(&frame);
+    const int h = GST_VIDEO_FRAME_HEIGHT(&frame);
+    cairo_surface_t* s = cairo_image_surface_create_for_data(
+        static_cast<unsigned char*>(GST_VIDEO_FRAME_PLANE_DATA(&frame, 0)), CAIRO_FORMAT_RGB24, w, h,
+        GST_VIDEO_FRAME_PLANE_STRIDE(&frame, 0));
+    cairo_save(cr);
+    cairo_rectangle(cr, t.x, t.y, t.w, t.h);
+    cairo_clip(cr);
+    cairo_translate(cr, t.x, t.y);
+    cairo_scale(cr, (double)t.w / w, (double)t.h / h);
+    cairo_set_source_surface(cr, s, 0, 0);
+    cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_BILINEAR);
+    cairo_paint(cr);
+    cairo_restore(cr);
+    cairo_surface_destroy(s);
+    gst_video_frame_unmap(&frame);
+}
+
+static gboolean on_draw(GtkWidget* widget, cairo_t* cr, gpointer user_data) {
+    RenderLoop* r = static_cast<RenderLoop*>(user_data);
+    const int width = gtk_widget_get_allocated_width(widget);
+    const int height = gtk_widget_get_allocated_height(widget);
+    GdkRectangle clip;
+    if (!gdk_cairo_get_clip_rectangle(cr, &clip)) return TRUE;
+    for (size_t i = 0; i < r->tiles.size(); ++i) {
+        TileRect t = grid_tile(r->layout, (int)i, width, height);
+        GdkRectangle rect {t.x, t.y, t.w, t.h};
+        if (!gdk_rectangle_intersect(&clip, &rect, nullptr)) continue;  // only the damaged tiles
+        const MailboxFrame* f = frame_mailbox_current(r->tiles[i].mailbox);
+        if (f->sample) {
+            paint_sample(cr, f->sample, t);
+        } else {
+            cairo_set_source_rgb(cr, 0, 0, 0);
+            cairo_rectangle(cr, t.x, t.y, t.w, t.h);
+            cairo_fill(cr);
+        }
+    }
+    return TRUE;
+}
+
+static gboolean on_tick(GtkWidget* widget, GdkFrameClock* clock, gpointer user_data) {
+    RenderLoop* r = static_cast<RenderLoop*>(user_data);
+    ++r->ticks;
+    const gint64 now = gdk_frame_clock_get_frame_time(clock);  // same clock as g_get_monotonic_time()
+    const int width = gtk_widget_get_allocated_width(widget);
+    const int height = gtk_widget_get_allocated_height(widget);
+    for (size_t i = 0; i < r->tiles.size(); ++i) {
+        const MailboxFrame* f = frame_mailbox_take(r->tiles[i].mailbox);
+        if (!f || !f->sample) continue;
+        if (r->tiles[i].metrics) stream_metrics_display_age(r->tiles[i].metrics, now - f->arrival_us);
+        ++r->composed;
+        TileRect t = grid_tile(r->layout, (int)i, width, height);
+        gtk_widget_queue_draw_area(widget, t.x, t.y, t.w, t.h);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+// Closing the window destroys the area, and its tick callback with it
+static void on_area_destroy(GtkWidget* /*widget*/, gpointer user_data) {
+    RenderLoop* r = static_cast<RenderLoop*>(user_data);
+    r->area = nullptr;
+    r->tick_id = 0;
+}
+
+GtkWidget* render_loop_create(RenderLoop* r, const GridLayout& layout) {
+    r->layout = layout;
+    r->area = gtk_drawing_area_new();
+    gtk_widget_set_hexpand(r->area, TRUE);
+    gtk_widget_set_vexpand(r->area, TRUE);
+    g_signal_connect(r->area, "draw", G_CALLBACK(on_draw), r);
+    g_signal_connect(r->area, "destroy", G_CALLBACK(on_area_destroy), r);
+    r->tick_id = gtk_widget_add_tick_callback(r->area, on_tick, r, nullptr);
+    return r->area;
+}
+
+void render_loop_add_tile(RenderLoop* r, FrameMailbox* mb, StreamMetrics* m) {
+    r->tiles.push_back(RenderTile {mb, m});
+}
+
+void render_loop_stop(RenderLoop* r) {
+    if (r->area && r->tick_id) gtk_widget_remove_tick_callback(r->area, r->tick_id);
+    r->tick_id = 0;
+    g_print("[render] %" G_GUINT64_FORMAT " refreshes, %" G_GUINT64_FORMAT " tile frames composed\n", r->ticks,
+            r->composed);
+    for (const RenderTile& t : r->tiles) {
+        const guint64 written = t.mailbox->written.load();
+        const guint64 dropped = t.mailbox->dropped.load();
+        if (!t.metrics) {
+            g_print("[%s] %" G_GUINT64_FORMAT " frames, %" G_GUINT64_FORMAT " dropped unseen\n",
+                    t.mailbox->name.c_str(), written, dropped);
+            continue;
+        }
+        LatencyHistogram age;
+        stream_metrics_age(t.metrics, age);
+        g_print("[%s] %" G_GUINT64_FORMAT " frames, %" G_GUINT64_FORMAT " dropped unseen, age at display p50 %.1f ms"
+                " p95 %.1f ms\n", t.metrics->name.c_str(), written, dropped, latency_quantile_ms(age, 0.50),
+                latency_quantile_ms(age, 0.95));
+    }
+}
@@ -0,0 +1,37 @@
+// render_loop_gtk.h
+// One drawing area for the whole grid, composed from the tiles' frame mailboxes at display refresh.
+//
+// A tick callback on the widget's frame clock (once per vsync) takes the newest frame of every
+// tile, records its age (mailbox -> this frame) and invalidates just the tiles that changed; GTK
+// merges them into a single redraw per refresh however many cameras delivered. The draw handler
+// paints each tile straight from the mapped decoder buffer (cairo RGB24 over BGRx, no copy).
+#pragma once
+
+#include <gtk/gtk.h>
+
+#include <vector>
+
+#include "frame_mailbox.h"
+#include "metrics.h"
+#include "stream_set.h"
+
+struct RenderTile {
+    FrameMailbox* mailbox {nullptr};
+    StreamMetrics* metrics {nullptr};  // display age (optional)
+};
+
+struct RenderLoop {
+    GtkWidget* area {nullptr};
+    GridLayout layout;
+    std::vector<RenderTile> tiles;  // row-major, like grid_tile()
+    guint tick_id {0};
+    guint64 ticks {0};
+    guint64 composed {0};           // new tile frames painted
+};
+
+// Creates the drawing area; add it to the window and the tiles in grid order.
+GtkWidget* render_loop_create(RenderLoop* r, const GridLayout& layout);
+void render_loop_add_tile(RenderLoop* r, FrameMailbox* mb, StreamMetrics* m);
+
+// Removes the tick callback and logs per tile: frames composed and dropped, display age p50/p95.
+void render_loop_stop(RenderLoop* r);
@@ -0,0 +1,113 @@
+// startup.cpp
+#include "startup.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+
+#include "bus_dispatch.h"
+
+struct PlayRequest {
+    GstElement* pipeline;
+    GSourceFunc failed;
+    gpointer user_data;
+    GstState via {GST_STATE_VOID_PENDING};  // READY/NULL first for a replay
+    GstElement* src {nullptr};  // gets `location` while in READY
+    std::string location;
+};
+
+static void play_one(gpointer data, gpointer) {
+    PlayRequest* r = static_cast<PlayRequest*>(data);
+    if (r->via != GST_STATE_VOID_PENDING) gst_element_set_state(r->pipeline, r->via);
+    if (r->src) {
+        g_object_set(G_OBJECT(r->src), "location", r->location.c_str(), NULL);
+        gst_object_unref(r->src);
+    }
+    if (gst_element_set_state(r->pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE && r->failed) {
+        g_idle_add(r->failed, r->user_data);
+    }
+    gst_object_unref(r->pipeline);
+    delete r;
+}
+
+static void push_play(PlayRequest* r) {
+    // Shared GLib threads: created on demand, idle ones exit on their own
+    static GThreadPool* pool = g_thread_pool_new(play_one, nullptr, 16, FALSE, nullptr);
+    g_thread_pool_push(pool, r, nullptr);
+}
+
+void startup_play_async(GstElement* pipeline, GSourceFunc failed, gpointer user_data) {
+    push_play(new PlayRequest {GST_ELEMENT(gst_object_ref(pipeline)), failed, user_data});
+}
+
+void startup_replay_async(GstElement* pipeline, GstState via, GstElement* src, const std::string& location,
+                          GSourceFunc failed, gpointer user_data) {
+    PlayRequest* r = new PlayRequest {GST_ELEMENT(gst_object_ref(pipeline)), failed, user_data};
+    r->via = via;
+    if (src) {
+        r->src = GST_ELEMENT(gst_object_ref(src));
+        r->location = location;
+    }
+    push_play(r);
+}
+
+struct StartupTracker {
+    std::vector<const StreamLifecycle*> streams;
+    gint64 t0_us;
+    gint64 deadline_us;
+};
+
+static gboolean track_cb(gpointer data) {
+    StartupTracker* t = static_cast<StartupTracker*>(data);
+    size_t live = 0;
+    gint64 last_us = t->t0_us;
+    for (const StreamLifecycle* lc : t->streams) {
+        if (stream_state_phase(lc) == StreamPhase::Playing) {
+            ++live;
+            last_us = std::max(last_us, lc->marks[(int)StreamMark::Displayed].load(std::memory_order_relaxed));
+        }
+    }
+    if (live == t->streams.size()) {
+        g_print("[startup] All %zu tiles live in %" G_GINT64_FORMAT " ms\n", live, (last_us - t->t0_us) / 1000);
+    } else if (g_get_monotonic_time() >= t->deadline_us) {
+        // Where each missing tile is stuck, e.g. "cam3 (backoff 12.4 s)"
+        std::string missing;
+        for (const StreamLifecycle* lc : t->streams) {
+            StreamPhase phase = stream_state_phase(lc);
+            if (phase == StreamPhase::Playing) continue;
+            gchar* where = g_strdup_printf("%s (%s %.1f s)", lc->name.c_str(), stream_phase_name(phase),
+                                           stream_state_age_ms(lc) / 1000.0);
+            missing += (missing.empty() ? "" : ", ") + std::string(where);
+            g_free(where);
+        }
+        g_print("[startup] %zu of %zu tiles live after %" G_GINT64_FORMAT " s; still waiting for %s\n", live,
+                t->streams.size(), (t->deadline_us - t->t0_us) / G_USEC_PER_SEC, missing.c_str());
+    } else {
+        return G_SOURCE_CONTINUE;
+    }
+    delete t;
+    return G_SOURCE_REMOVE;
+}
+
+void startup_track(const std::vector<const StreamLifecycle*>& streams, gint64 t0_us, int timeout_s) {
+    if (streams.empty()) return;
+    StartupTracker* t = new StartupTracker {streams, t0_us, t0_us + (gint64)timeout_s * G_USEC_PER_SEC};
+    g_timeout_add(50, track_cb, t);
+}
+
+gint64 shutdown_all(const std::vector<GstElement*>& pipelines) {
+    const gint64 t0 = g_get_monotonic_time();
+    GMainContext* ctx = g_main_context_default();
+    std::atomic<size_t> left {pipelines.size()};
+    for (GstElement* p : pipelines) {
+        bus_dispatch_dispose(p, [&left, ctx] {
+            --left;
+            g_main_context_wakeup(ctx);
+        });
+    }
+    // Sinks that marshal their teardown to the GTK thread need this context to keep running
+    while (left > 0) g_main_context_iteration(ctx, TRUE);
+    const gint64 ms = (g_get_monotonic_time() - t0) / 1000;
+    g_print("[startup] Stopped %zu pipelines in %" G_GINT64_FORMAT " ms\n", pipelines.size(), ms);
+    return ms;
+}
@@ -0,0 +1,41 @@
+// startup.h
+// Concurrent bring-up and shutdown of all camera pipelines, with timings.
+//
+// Setting PLAYING returns before rtspsrc has connected (DESCRIBE/SETUP/PLAY run on its own task),
+// but the state change still opens every element of the pipeline on the calling thread: decoder
+// devices, sinks, sockets. One camera after another on the GTK thread, that adds up before the
+// window even shows. Going to NULL is worse: rtspsrc sends TEARDOWN and waits for the answer, so
+// N cameras took N round trips (N timeouts for dead ones) to exit.
+//
+//   startup_play_async()  PLAYING on a shared pool (up to 16 at once); the caller returns at once,
+//                         which the GTK thread must do anyway, since gtksink hops to it while starting
+//   startup_replay_async() READY (or NULL) -> PLAYING on the same pool, for a restart or a
+//                         main/sub switch
+//   startup_track()       logs once when every stream is showing frames: "All 16 tiles live in
+//                         1840 ms", or after a deadline the ones still missing
+//   shutdown_all()        every pipeline to NULL at once (bus_dispatch_dispose), running the default
+//                         main context meanwhile; logs "Stopped 16 pipelines in 95 ms"
+#pragma once
+
+#include <gst/gst.h>
+
+#include <string>
+#include <vector>
+
+#include "stream_state.h"
+
+// Sets `pipeline` to PLAYING on the start pool. On failure `failed` is added as an idle callback
+// on the default main context (the GTK thread).
+void startup_play_async(GstElement* pipeline, GSourceFunc failed, gpointer user_data);
+// `via` (READY or NULL: TEARDOWN, which can block for seconds on a dead camera), then PLAYING, on
+// the start pool. With `src`, its "location" is set to `location` in between. `failed` as above.
+void startup_replay_async(GstElement* pipeline, GstState via, GstElement* src, const std::string& location,
+                          GSourceFunc failed, gpointer user_data);
+
+// Logs the time from `t0_us` (g_get_monotonic_time() before the first start) until every stream
+// in `streams` reached Playing. Polled on the default main context; gives up after `timeout_s`.
+void startup_track(const std::vector<const StreamLifecycle*>& streams, gint64 t0_us, int timeout_s);
+
+// Takes the references of `pipelines`, stops them all in parallel and returns once they are gone.
+// Returns the time taken in ms.
+gint64 shutdown_all(const std::vector<GstElement*>& pipelines);
@@ -0,0 +1,56 @@
+// stream_set.h
+// Camera list + grid layout shared by every entry point (Windows and Linux builds).
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct CameraConfig {
+    std::string name;     // "cam1", "cam2", ... unless given in the camera file
+    std::string url;      // main stream
+    std::string sub_url;  // sub-stream; empty if the camera has none
+};
+
+struct GridLayout {
+    int rows {1};
+    int cols {1};
+};
+
+struct TileRect {
+    int x {0};
+    int y {0};
+    int w {0};
+    int h {0};
+};
+
+// The four cameras the viewer was originally written for.
+std::vector<CameraConfig> default_cameras();
+
+// Camera file format: one camera per line, "[name] main_url [sub_url]". Without a sub_url it is
+// derived from the main URL when the pattern is known (see derive_sub_url), "-" disables it.
+// Empty lines and lines starting with '#' are ignored.
+bool load_camera_file(const std::string& path, std::vector<CameraConfig>& out, std::string* err = nullptr);
+
+// Resolution order: "--cameras FILE" on the command line, $GRID_CAMERAS, ./cameras.txt,
+// then default_cameras() only when there is no cameras.txt. Empty (error logged, the caller exits)
+// when the chosen file cannot be read or parsed. argv may be null (Windows wWinMain).
+std::vector<CameraConfig> load_cameras(int argc, char** argv);
+
+// Hikvision ".../Channels/101" -> ".../Channels/102" and Dahua "subtype=0" -> "subtype=1";
+// empty string when the URL matches neither.
+std::string derive_sub_url(const std::string& main_url);
+
+// Main stream only when the tile is taller than $GRID_MAIN_MIN_HEIGHT (default 600) pixels;
+// a sub-stream (typically 640x360 / 704x576) already has all the detail a smaller tile can show.
+bool tile_wants_main_stream(int tile_w, int tile_h);
+
+// URL to play for a tile of the given size.
+const std::string& camera_url_for(const CameraConfig& cam, int tile_w, int tile_h);
+
+// Smallest near-square RxC grid holding n tiles (cols >= rows). $GRID_LAYOUT="RxC" overrides it
+// as long as it still has room for n tiles.
+GridLayout grid_layout_for(size_t n);
+
+// Pixel rectangle of tile `index` (row-major) in a width x height area. The last row/column absorbs
+// the rounding remainder so the tiles always cover the whole area.
+TileRect grid_tile(const GridLayout& layout, int index, int width, int height);
@@ -0,0 +1,118 @@
+// stream_state.cpp
+#include "stream_state.h"
+
+#include <string>
+
+static const char* const kPhaseNames[kStreamPhases] = {
+    "idle", "connecting", "described", "negotiated", "prerolled", "playing", "stalled", "backoff",
+};
+
+static const char* const kSpanNames[kStartupSpans] = { "describe", "setup", "play", "decode", "display", "total" };
+
+// Phase an attempt reaches with each mark (Idle: the mark only records a time)
+static const StreamPhase kMarkPhase[kStreamMarks] = {
+    StreamPhase::Idle, StreamPhase::Described, StreamPhase::Negotiated,
+    StreamPhase::Idle, StreamPhase::Prerolled, StreamPhase::Playing,
+};
+
+const char* stream_phase_name(StreamPhase phase) {
+    int i = (int)phase;
+    return i >= 0 && i < kStreamPhases ? kPhaseNames[i] : "?";
+}
+
+const char* startup_span_name(int span) {
+    return span >= 0 && span < kStartupSpans ? kSpanNames[span] : "?";
+}
+
+void stream_state_init(StreamLifecycle* lc, const std::string& name) {
+    lc->name = name;
+    lc->phase = (int)StreamPhase::Idle;
+    lc->entered_us = g_get_monotonic_time();
+    for (auto& s : lc->spans_us) s = -1;
+}
+
+static bool is_active(int phase) {
+    return phase >= (int)StreamPhase::Connecting && phase <= (int)StreamPhase::Playing;
+}
+
+// One compare-exchange from `cur`; on failure `cur` holds the phase that won.
+static bool transition(StreamLifecycle* lc, int& cur, StreamPhase to, gint64 now) {
+    if (!lc->phase.compare_exchange_strong(cur, (int)to)) return false;
+    lc->entered_us.store(now, std::memory_order_relaxed);
+    lc->entries[(int)to].fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool stream_state_enter(StreamLifecycle* lc, StreamPhase to) {
+    const gint64 now = g_get_monotonic_time();
+    if (to == StreamPhase::Connecting) {
+        for (auto& m : lc->marks) m.store(0, std::memory_order_relaxed);
+        lc->marks[(int)StreamMark::Connect].store(now, std::memory_order_relaxed);
+    }
+    int cur = lc->phase.load();
+    for (;;) {
+        bool allowed = false;
+        switch (to) {
+        case StreamPhase::Idle: allowed = cur != (int)StreamPhase::Idle; break;
+        case StreamPhase::Connecting: allowed = true; break;
+        case StreamPhase::Stalled: allowed = is_active(cur); break;
+        case StreamPhase::Backoff: allowed = cur != (int)StreamPhase::Idle && cur != (int)StreamPhase::Backoff; break;
+        default: break;  // forward steps only come from stream_state_mark()
+        }
+        if (!allowed) return false;
+        if (transition(lc, cur, to, now)) break;
+    }
+    if (to == StreamPhase::Connecting) lc->attempts.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+static std::string ms_or_dash(gint64 us) {
+    return us < 0 ? std::string("-") : std::to_string(us / 1000);
+}
+
+// Attempt reached Playing: keep the span durations and log them.
+static void finish_attempt(StreamLifecycle* lc) {
+    gint64 t[kStreamMarks];
+    for (int i = 0; i < kStreamMarks; ++i) t[i] = lc->marks[i].load(std::memory_order_relaxed);
+    auto span = [&](StreamMark a, StreamMark b) -> gint64 {
+        gint64 ta = t[(int)a], tb = t[(int)b];
+        return ta && tb && tb >= ta ? tb - ta : -1;
+    };
+    const gint64 spans[kStartupSpans] = {
+        span(StreamMark::Connect, StreamMark::Sdp),
+        span(StreamMark::Sdp, StreamMark::Pads),
+        span(StreamMark::Pads, StreamMark::FirstRtp),
+        span(StreamMark::FirstRtp, StreamMark::Decoded),
+        span(StreamMark::Decoded, StreamMark::Displayed),
+        span(StreamMark::Connect, StreamMark::Displayed),
+    };
+    for (int i = 0; i < kStartupSpans; ++i) lc->spans_us[i].store(spans[i], std::memory_order_relaxed);
+
+    g_print("[%s] Playing %s ms after %s (describe %s, setup %s, play %s, decode %s, display %s)\n",
+            lc->name.c_str(), ms_or_dash(spans[5]).c_str(), lc->attempts.load() > 1 ? "reconnect" : "connect",
+            ms_or_dash(spans[0]).c_str(), ms_or_dash(spans[1]).c_str(), ms_or_dash(spans[2]).c_str(),
+            ms_or_dash(spans[3]).c_str(), ms_or_dash(spans[4]).c_str());
+}
+
+void stream_state_mark(StreamLifecycle* lc, StreamMark mark) {
+    // Fast path for the per-buffer probes: nothing to record outside a connect attempt
+    int cur = lc->phase.load(std::memory_order_relaxed);
+    if (cur < (int)StreamPhase::Connecting || cur >= (int)StreamPhase::Playing) return;
+
+    const gint64 now = g_get_monotonic_time();
+    gint64 unset = 0;
+    if (!lc->marks[(int)mark].compare_exchange_strong(unset, now)) return;  // seen in this attempt
+
+    const StreamPhase target = kMarkPhase[(int)mark];
+    if (target == StreamPhase::Idle) return;
+    while (cur >= (int)StreamPhase::Connecting && cur < (int)target) {
+        if (transition(lc, cur, target, now)) {
+            if (target == StreamPhase::Playing) finish_attempt(lc);
+            return;
+        }
+    }
+}
+
+gint64 stream_state_age_ms(const StreamLifecycle* lc) {
+    return (g_get_monotonic_time() - lc->entered_us.load(std::memory_order_relaxed)) / 1000;
+}
@@ -0,0 +1,73 @@
+// stream_state.h
+// Per-stream lifecycle state machine with timestamped transitions and startup phase timings.
+//
+//   Idle -> Connecting -> Described -> Negotiated -> Prerolled -> Playing
+//               ^                                                  |
+//               +-------- Backoff <-------- Stalled <--------------+  (ERROR, EOS, no frames)
+//
+// The builder drives Connecting, Stalled, Backoff and Idle: it decides when to connect, notices
+// failures and schedules the retry. The forward steps come from the pipeline, on whichever thread
+// sees them first:
+//   Described   rtspsrc "on-sdp" (DESCRIBE answered)
+//   Negotiated  rtspsrc pad-added (SETUPs answered, transport chosen; PLAY is sent next)
+//   Prerolled   first decoded frame
+//   Playing     first frame at the sink (or the mosaic mixer)
+// and the first RTP packet is timestamped in between. The phase and the timestamps are atomics
+// moved by compare-exchange, so probes and bus handlers never take a lock, and a late probe from
+// an attempt that already failed cannot move it forward again.
+//
+// When an attempt reaches Playing its phase durations are logged in one line and kept for
+// metrics:
+//   describe  connect -> SDP
+//   setup     SDP -> source pads (SETUP round trips)
+//   play      source pads -> first RTP packet (PLAY round trip and the first packet)
+//   decode    first RTP packet -> first decoded frame (includes waiting for a keyframe)
+//   display   first decoded -> first displayed frame
+//   total     connect -> first displayed frame
+// A step the build does not observe (no decoder probe, SDP signal missing) is reported as -1.
+#pragma once
+
+#include <gst/gst.h>
+
+#include <atomic>
+#include <string>
+
+enum class StreamPhase { Idle, Connecting, Described, Negotiated, Prerolled, Playing, Stalled, Backoff };
+static const int kStreamPhases = 8;
+
+// Timestamped steps of one connect attempt
+enum class StreamMark { Connect, Sdp, Pads, FirstRtp, Decoded, Displayed };
+static const int kStreamMarks = 6;
+
+static const int kStartupSpans = 6;  // describe, setup, play, decode, display, total
+
+struct StreamLifecycle {
+    std::string name;
+    std::atomic<int> phase {(int)StreamPhase::Idle};
+    std::atomic<gint64> entered_us {0};                  // when the current phase began
+    std::atomic<gint64> marks[kStreamMarks] {};          // current attempt, 0 = not seen yet
+    std::atomic<gint64> spans_us[kStartupSpans] {};      // last attempt that reached Playing
+    std::atomic<guint64> entries[kStreamPhases] {};      // times each phase was entered
+    std::atomic<guint64> attempts {0};
+};
+
+const char* stream_phase_name(StreamPhase phase);
+const char* startup_span_name(int span);
+
+void stream_state_init(StreamLifecycle* lc, const std::string& name);
+
+// Builder-driven transitions. Connecting starts a new attempt (from any phase, e.g. a main/sub
+// stream switch while playing); Stalled only leaves an active phase; Backoff follows Stalled or an
+// active phase; Idle is always allowed. False when the transition does not apply.
+bool stream_state_enter(StreamLifecycle* lc, StreamPhase to);
+
+// Pipeline-driven steps (probes, signals). Records the first occurrence in the current attempt and
+// moves the phase forward; a no-op once Playing or after the attempt failed.
+void stream_state_mark(StreamLifecycle* lc, StreamMark mark);
+
+inline StreamPhase stream_state_phase(const StreamLifecycle* lc) {
+    return (StreamPhase)lc->phase.load(std::memory_order_relaxed);
+}
+
+// Milliseconds in the current phase.
+gint64 stream_state_age_ms(const StreamLifecycle* lc);
@@ -0,0 +1,97 @@
+// visibility.cpp
+#include "visibility.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#ifdef __linux__
+#include <dirent.h>
+#endif
+
+static bool hidden_drop_all() {
+    static const bool drop_all = [] {
+        const char* env = std::getenv("GRID_HIDDEN_MODE");
+        return env && std::strcmp(env, "drop") == 0;
+    }();
+    return drop_all;
+}
+
+static GstPadProbeReturn on_parser_output(GstPad* /*pad*/, GstPadProbeInfo* info, gpointer user_data) {
+    DecodeGate* g = static_cast<DecodeGate*>(user_data);
+    GstBuffer* buf = GST_PAD_PROBE_INFO_BUFFER(info);
+    const bool is_delta = GST_BUFFER_FLAG_IS_SET(buf, GST_BUFFER_FLAG_DELTA_UNIT);
+
+    if (g->hidden.load(std::memory_order_relaxed)) {
+        if (is_delta || hidden_drop_all()) {
+            g->dropped.fetch_add(1, std::memory_order_relaxed);
+            return GST_PAD_PROBE_DROP;
+        }
+        return GST_PAD_PROBE_OK;
+    }
+    if (g->wait_keyframe.load(std::memory_order_relaxed)) {
+        if (is_delta) {
+            g->dropped.fetch_add(1, std::memory_order_relaxed);
+            return GST_PAD_PROBE_DROP;
+        }
+        g->wait_keyframe.store(false, std::memory_order_relaxed);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+void decode_gate_attach(DecodeGate* gate, GstElement* parser) {
+    GstPad* src = gst_element_get_static_pad(parser, "src");
+    if (!src) return;
+    gst_pad_add_probe(src, GST_PAD_PROBE_TYPE_BUFFER, on_parser_output, gate, nullptr);
+    gst_object_unref(src);
+}
+
+static void on_deep_element_added(GstBin* /*bin*/, GstBin* /*sub_bin*/, GstElement* element, gpointer user_data) {
+    GstElementFactory* factory = gst_element_get_factory(element);
+    if (!factory) return;
+    const gchar* klass = gst_element_factory_get_metadata(factory, GST_ELEMENT_METADATA_KLASS);
+    if (klass && strstr(klass, "Parser") && strstr(klass, "Video")) {
+        decode_gate_attach(static_cast<DecodeGate*>(user_data), element);
+    }
+}
+
+void decode_gate_watch_parsers(DecodeGate* gate, GstElement* bin) {
+    g_signal_connect(bin, "deep-element-added", G_CALLBACK(on_deep_element_added), gate);
+}
+
+void decode_gate_set_visible(DecodeGate* gate, bool visible) {
+    bool was_hidden = gate->hidden.exchange(!visible);
+    // The first realized state is where the tile starts, not a transition: every tile would log it
+    if (!gate->known.exchange(true) || was_hidden == !visible) return;
+    if (visible) {
+        gate->wait_keyframe.store(true);
+        g_print("[%s] Visible: full decode from next keyframe (%" G_GUINT64_FORMAT " frames skipped)\n",
+                gate->name.c_str(), gate->dropped.load());
+    } else {
+        g_print("[%s] Hidden: %s\n", gate->name.c_str(), hidden_drop_all() ? "decode paused" : "keyframe-only decode");
+    }
+}
+
+bool display_powered_on() {
+#ifdef __linux__
+    DIR* d = opendir("/sys/class/drm");
+    if (!d) return true;
+    bool any_connected = false;
+    bool any_on = false;
+    while (struct dirent* e = readdir(d)) {
+        // connectors look like card0-HDMI-A-1
+        if (std::strncmp(e->d_name, "card", 4) != 0 || !std::strchr(e->d_name, '-')) continue;
+        std::string base = std::string("/sys/class/drm/") + e->d_name;
+        std::string status, dpms;
+        std::ifstream(base + "/status") >> status;
+        std::ifstream(base + "/dpms") >> dpms;
+        if (status != "connected") continue;
+        any_connected = true;
+        if (dpms.empty() || dpms == "On") any_on = true;
+    }
+    closedir(d);
+    return !any_connected || any_on;
+#else
+    return true;
+#endif
+}
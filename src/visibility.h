@@ -0,0 +1,35 @@
+// visibility.h
+// Decode suspension for tiles nobody can see.
+//
+// A DecodeGate sits on the parser's src pad (encoded, keyframe-flagged buffers). While the tile is
+// hidden it drops delta frames so the decoder only decodes keyframes (GRID_HIDDEN_MODE=keyframes,
+// the default) or drops everything (GRID_HIDDEN_MODE=drop). When the tile becomes visible again
+// it keeps showing the last decoded keyframe and lets data through from the next keyframe on, so
+// the decoder never sees a delta frame whose references were dropped.
+#pragma once
+
+#include <gst/gst.h>
+
+#include <atomic>
+#include <string>
+
+struct DecodeGate {
+    std::string name;
+    std::atomic<bool> hidden {false};
+    std::atomic<bool> wait_keyframe {false};
+    std::atomic<guint64> dropped {0};
+    std::atomic<bool> known {false};  // set by the first decode_gate_set_visible(), which does not log
+};
+
+// Probe the src pad of an explicitly created parser (h264parse/h265parse/...).
+void decode_gate_attach(DecodeGate* gate, GstElement* parser);
+
+// Probe every video parser that gets added anywhere inside `bin` (also later, e.g. in pad-added).
+void decode_gate_watch_parsers(DecodeGate* gate, GstElement* bin);
+
+// Logs "[cam] Hidden: ..." / "[cam] Visible: ..." on changes after the first call.
+void decode_gate_set_visible(DecodeGate* gate, bool visible);
+
+// Linux KMS: true if at least one connected DRM connector reports DPMS "On" (or if the state
+// cannot be read). A blanked console reports "Off" on every connector.
+bool display_powered_on();
@@ -0,0 +1,52 @@
+// visibility_gtk.cpp
+#include "visibility_gtk.h"
+
+static void update_gates(WindowVisibility* wv) {
+    bool window_visible = wv->mapped && !wv->iconified && !wv->obscured;
+    for (auto& tile : wv->tiles) {
+        bool visible = window_visible && (!tile.first || gtk_widget_get_mapped(tile.first));
+        decode_gate_set_visible(tile.second, visible);
+    }
+}
+
+static gboolean on_window_state(GtkWidget* /*w*/, GdkEventWindowState* ev, gpointer user_data) {
+    WindowVisibility* wv = static_cast<WindowVisibility*>(user_data);
+    wv->iconified = (ev->new_window_state & (GDK_WINDOW_STATE_ICONIFIED | GDK_WINDOW_STATE_WITHDRAWN)) != 0;
+    update_gates(wv);
+    return FALSE;
+}
+
+static gboolean on_window_map(GtkWidget* /*w*/, GdkEvent* ev, gpointer user_data) {
+    WindowVisibility* wv = static_cast<WindowVisibility*>(user_data);
+    wv->mapped = (ev->type == GDK_MAP);
+    update_gates(wv);
+    return FALSE;
+}
+
+// Only delivered on X11 without a compositor; composited desktops never report "obscured".
+static gboolean on_window_visibility(GtkWidget* /*w*/, GdkEventVisibility* ev, gpointer user_data) {
+    WindowVisibility* wv = static_cast<WindowVisibility*>(user_data);
+    wv->obscured = (ev->state == GDK_VISIBILITY_FULLY_OBSCURED);
+    update_gates(wv);
+    return FALSE;
+}
+
+static void on_tile_map_changed(GtkWidget* /*w*/, gpointer user_data) {
+    update_gates(static_cast<WindowVisibility*>(user_data));
+}
+
+void visibility_track_window(WindowVisibility* wv, GtkWidget* window) {
+    gtk_widget_add_events(window, GDK_STRUCTURE_MASK | GDK_VISIBILITY_NOTIFY_MASK);
+    g_signal_connect(window, "window-state-event", G_CALLBACK(on_window_state), wv);
+    g_signal_connect(window, "map-event", G_CALLBACK(on_window_map), wv);
+    g_signal_connect(window, "unmap-event", G_CALLBACK(on_window_map), wv);
+    g_signal_connect(window, "visibility-notify-event", G_CALLBACK(on_window_visibility), wv);
+}
+
+void visibility_track_tile(WindowVisibility* wv, GtkWidget* widget, DecodeGate* gate) {
+    wv->tiles.emplace_back(widget, gate);
+    if (widget) {
+        g_signal_connect(widget, "map", G_CALLBACK(on_tile_map_changed), wv);
+        g_signal_connect(widget, "unmap", G_CALLBACK(on_tile_map_changed), wv);
+    }
+}
@@ -0,0 +1,23 @@
+// visibility_gtk.h
+// GTK glue for DecodeGate: a tile is visible while the window is mapped, not minimized, not
+// fully obscured (X11 without compositor) and the tile widget itself is mapped.
+#pragma once
+
+#include <gtk/gtk.h>
+
+#include <utility>
+#include <vector>
+
+#include "visibility.h"
+
+struct WindowVisibility {
+    bool mapped {false};
+    bool iconified {false};
+    bool obscured {false};
+    std::vector<std::pair<GtkWidget*, DecodeGate*>> tiles;
+};
+
+void visibility_track_window(WindowVisibility* wv, GtkWidget* window);
+
+// `widget` may be null when several gates share the window (mosaic mode).
+void visibility_track_tile(WindowVisibility* wv, GtkWidget* widget, DecodeGate* gate);
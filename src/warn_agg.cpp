@@ -0,0 +1,115 @@
+// warn_agg.cpp
+#include "warn_agg.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+static const size_t kMaxEntries = 32;  // further keys share the last entry
+
+static std::mutex registry_mutex;
+static std::vector<WarningAggregator*> registry;
+
+static gint64 interval_us() {
+    static const gint64 us = [] {
+        const char* env = std::getenv("GRID_WARN_INTERVAL");
+        int s = (env && *env) ? std::atoi(env) : 10;
+        return (gint64)(s > 0 ? s : 10) * G_USEC_PER_SEC;
+    }();
+    return us;
+}
+
+WarningAggregator::~WarningAggregator() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    registry.erase(std::remove(registry.begin(), registry.end(), this), registry.end());
+}
+
+void warning_agg_init(WarningAggregator* wa, const std::string& name) {
+    wa->name = name;
+    wa->window_start_us = g_get_monotonic_time();
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    if (std::find(registry.begin(), registry.end(), wa) == registry.end()) registry.push_back(wa);
+}
+
+// Caller holds wa->mu.
+static void flush_window(WarningAggregator* wa, gint64 now) {
+    int secs = (int)((now - wa->window_start_us) / G_USEC_PER_SEC);
+    for (WarningEntry& e : wa->entries) {
+        e.shown = false;
+        if (!e.suppressed) continue;
+        g_printerr("[%s][WARN] %s: \"%s\" repeated %llu times in %d s (%llu total)\n",
+                   wa->name.c_str(), e.source.c_str(), e.message.c_str(),
+                   (unsigned long long)e.suppressed, secs, (unsigned long long)e.total);
+        e.suppressed = 0;
+    }
+    wa->window_start_us = now;
+}
+
+void warning_agg_tick(WarningAggregator* wa) {
+    gint64 now = g_get_monotonic_time();
+    std::lock_guard<std::mutex> lock(wa->mu);
+    if (now - wa->window_start_us >= interval_us()) flush_window(wa, now);
+}
+
+void warning_agg_tick_all() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (WarningAggregator* wa : registry) warning_agg_tick(wa);
+}
+
+void warning_agg_add(WarningAggregator* wa, GstMessage* msg) {
+    // Read the GError in place: no gst_message_parse_warning() copies for a repeat
+    const GstStructure* st = gst_message_get_structure(msg);
+    const GValue* v = st ? gst_structure_get_value(st, "gerror") : nullptr;
+    const GError* err = v ? static_cast<const GError*>(g_value_get_boxed(v)) : nullptr;
+    const gchar* src = GST_MESSAGE_SRC(msg) ? GST_OBJECT_NAME(GST_MESSAGE_SRC(msg)) : nullptr;
+    if (!src) src = "?";
+    GQuark domain = err ? err->domain : 0;
+    int code = err ? err->code : 0;
+
+    wa->total.fetch_add(1, std::memory_order_relaxed);
+    gint64 now = g_get_monotonic_time();
+    std::lock_guard<std::mutex> lock(wa->mu);
+    if (now - wa->window_start_us >= interval_us()) flush_window(wa, now);
+
+    WarningEntry* e = nullptr;
+    for (WarningEntry& it : wa->entries) {
+        if (it.domain == domain && it.code == code && it.source == src) { e = &it; break; }
+    }
+    if (!e && wa->entries.size() < kMaxEntries) {
+        wa->entries.push_back(WarningEntry{});
+        e = &wa->entries.back();
+        e->source = src;
+        e->domain = domain;
+        e->code = code;
+        e->message = err && err->message ? err->message : "";
+    } else if (!e) {
+        e = &wa->entries.back();
+    }
+
+    ++e->total;
+    if (e->shown) {
+        ++e->suppressed;
+        return;
+    }
+    e->shown = true;
+    const gchar* dbg = st ? gst_structure_get_string(st, "debug") : nullptr;
+    g_printerr("[%s][WARN] %s: %s | %s\n", wa->name.c_str(), src, err && err->message ? err->message : "",
+               dbg ? dbg : "");
+}
+
+void warning_agg_snapshot(std::vector<WarningCount>& out) {
+    out.clear();
+    std::lock_guard<std::mutex> reg(registry_mutex);
+    for (WarningAggregator* wa : registry) {
+        std::lock_guard<std::mutex> lock(wa->mu);
+        for (const WarningEntry& e : wa->entries) {
+            WarningCount c;
+            c.stream = wa->name;
+            c.source = e.source;
+            c.domain = e.domain ? g_quark_to_string(e.domain) : "";
+            c.code = e.code;
+            c.count = e.total;
+            out.push_back(c);
+        }
+    }
+}
@@ -0,0 +1,63 @@
+// warn_agg.h
+// Collapses repeated GStreamer WARNING messages into periodic summary lines.
+//
+// A flaky camera can post hundreds of identical warnings per second (RTP packet loss, late
+// buffers). Per (source element, error domain, code) the first warning of each interval is printed
+// in full; repeats in the same interval only bump a counter and are reported as one line when the
+// interval ends. The lookup reads the GError inside the message without copying it, so a
+// repeated warning costs the bus thread a short scan and two counter increments.
+//
+// $GRID_WARN_INTERVAL sets the interval in seconds (default 10).
+#pragma once
+
+#include <gst/gst.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct WarningEntry {
+    std::string source;      // element name
+    GQuark domain {0};
+    int code {0};
+    std::string message;     // text of the first occurrence
+    uint64_t total {0};
+    uint64_t suppressed {0}; // repeats in the current interval, not printed yet
+    bool shown {false};      // printed in full in the current interval
+};
+
+struct WarningCount {
+    std::string stream;
+    std::string source;
+    std::string domain;
+    int code {0};
+    uint64_t count {0};
+};
+
+// One per camera (or mosaic). Registered for metrics while it exists.
+struct WarningAggregator {
+    std::string name;        // log prefix, "cam1"
+    std::mutex mu;
+    std::vector<WarningEntry> entries;
+    gint64 window_start_us {0};
+    std::atomic<uint64_t> total {0};
+
+    ~WarningAggregator();
+};
+
+void warning_agg_init(WarningAggregator* wa, const std::string& name);
+
+// GST_MESSAGE_WARNING from the bus handler.
+void warning_agg_add(WarningAggregator* wa, GstMessage* msg);
+
+// Prints the summaries of an interval that is over. add() does this too; call it from an idle
+// bus loop iteration or timer so counts are not held back once the warnings stop.
+void warning_agg_tick(WarningAggregator* wa);
+
+// warning_agg_tick() for every registered aggregator (one timer in main-loop builds).
+void warning_agg_tick_all();
+
+// Totals since start of every registered aggregator, one row per (stream, source, domain, code).
+void warning_agg_snapshot(std::vector<WarningCount>& out);
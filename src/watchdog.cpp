@@ -0,0 +1,129 @@
+// watchdog.cpp
+#include "watchdog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "metrics.h"
+
+static const int kSlots = 64;
+static const gint64 kTickUs = 250 * 1000;  // wheel span 16 s; later deadlines wait out extra rounds
+
+struct WheelEntry {
+    StreamMetrics* m;
+    gint64 due_us;
+};
+
+static std::mutex wheel_mutex;
+static std::vector<WheelEntry> slots[kSlots];
+static int cursor = 0;
+static bool thread_started = false;
+
+int watchdog_timeout_ms() {
+    static const int ms = [] {
+        const char* env = std::getenv("GRID_STALL_MS");
+        int v = (env && *env) ? std::atoi(env) : 5000;
+        return v > 0 ? v : 0;
+    }();
+    return ms;
+}
+
+// Caller holds wheel_mutex.
+static void insert(StreamMetrics* m, gint64 due_us, gint64 now) {
+    gint64 ticks = std::max<gint64>(1, (due_us - now + kTickUs - 1) / kTickUs);
+    int slot = (int)((cursor + std::min<gint64>(ticks, kSlots - 1)) % kSlots);
+    slots[slot].push_back({m, due_us});
+}
+
+struct Stall {
+    std::string name;
+    GstElement* src;  // strong ref
+    gint64 silent_us;
+};
+
+// Caller holds wheel_mutex. A silent attempt is added to `stalls`, posted after the lock is gone.
+static void check(StreamMetrics* m, gint64 now, gint64 timeout_us, std::vector<Stall>& stalls) {
+    const int phase = m->state.phase.load(std::memory_order_relaxed);
+    const bool active = phase >= (int)StreamPhase::Connecting && phase <= (int)StreamPhase::Playing;
+    const guint64 attempt = m->state.attempts.load(std::memory_order_relaxed);
+    if (!active || m->stall_fired_attempt == attempt) {
+        insert(m, now + timeout_us, now);  // nothing to watch until the next attempt
+        return;
+    }
+    gint64 since = std::max(m->last_buffer_us.load(std::memory_order_relaxed),
+                            m->state.marks[(int)StreamMark::Connect].load(std::memory_order_relaxed));
+    if (since + timeout_us > now) {
+        insert(m, since + timeout_us, now);
+        return;
+    }
+
+    m->stall_fired_attempt = attempt;
+    insert(m, now + timeout_us, now);
+    if (GstElement* src = static_cast<GstElement*>(g_weak_ref_get(&m->source))) {
+        stalls.push_back({m->name, src, now - since});
+    }
+}
+
+// ERROR from the source itself, so the builders take their source-side reconnect path.
+static void post_stall(const Stall& s) {
+    g_printerr("[%s] No data for %" G_GINT64_FORMAT " ms; restarting the source\n", s.name.c_str(),
+               s.silent_us / 1000);
+    GError* err = g_error_new(GST_RESOURCE_ERROR, GST_RESOURCE_ERROR_READ, "No data from the camera for %d ms",
+                              (int)(s.silent_us / 1000));
+    gst_element_post_message(s.src, gst_message_new_error(GST_OBJECT(s.src), err, "data-flow watchdog"));
+    g_error_free(err);
+    gst_object_unref(s.src);
+}
+
+static void wheel_thread() {
+    const gint64 timeout_us = (gint64)watchdog_timeout_ms() * 1000;
+    gint64 next = g_get_monotonic_time() + kTickUs;
+    for (;;) {
+        gint64 wait = next - g_get_monotonic_time();
+        if (wait > 0) std::this_thread::sleep_for(std::chrono::microseconds(wait));
+        next += kTickUs;
+
+        std::vector<Stall> stalls;
+        {
+            std::lock_guard<std::mutex> lock(wheel_mutex);
+            cursor = (cursor + 1) % kSlots;
+            const gint64 now = g_get_monotonic_time();
+            std::vector<WheelEntry> due;
+            due.swap(slots[cursor]);
+            for (const WheelEntry& e : due) {
+                if (e.due_us > now) insert(e.m, e.due_us, now);  // more rounds to go
+                else check(e.m, now, timeout_us, stalls);
+            }
+        }
+        for (const Stall& s : stalls) post_stall(s);
+    }
+}
+
+void watchdog_watch(StreamMetrics* m) {
+    if (!watchdog_timeout_ms() || !m->stall_watch) return;
+    std::lock_guard<std::mutex> lock(wheel_mutex);
+    for (const auto& slot : slots) {
+        for (const WheelEntry& e : slot) {
+            if (e.m == m) return;  // already on the wheel; the new source is picked up at its slot
+        }
+    }
+    const gint64 now = g_get_monotonic_time();
+    insert(m, now + (gint64)watchdog_timeout_ms() * 1000, now);
+    if (!thread_started) {
+        thread_started = true;
+        std::thread(wheel_thread).detach();  // runs for the life of the process
+    }
+}
+
+void watchdog_forget(StreamMetrics* m) {
+    std::lock_guard<std::mutex> lock(wheel_mutex);
+    for (auto& slot : slots) {
+        slot.erase(std::remove_if(slot.begin(), slot.end(), [m](const WheelEntry& e) { return e.m == m; }),
+                   slot.end());
+    }
+}
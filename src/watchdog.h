@@ -0,0 +1,27 @@
+// watchdog.h
+// Data-flow watchdog: restarts the source of a stream whose camera stops sending RTP while its
+// RTSP session stays up (no ERROR or EOS ever arrives, so nothing else would notice).
+//
+// The ingress probe of every stream stamps the time of its last buffer (metrics.h); the watchdog
+// never touches the data path. One thread drives a hashed timer wheel for all streams: each stream
+// sits in the slot of its next deadline, last buffer (or the start of the connect attempt) plus
+// the no-data timeout. When the slot comes round, a stream that received data in the meantime is
+// moved to its new deadline; one that did not gets an ERROR posted as its rtspsrc ("No data from
+// the camera"). The builders already handle that like any other source error: a source swap
+// where they have one, a restart elsewhere, on the usual backoff. Checking costs one slot visit
+// per stream per timeout, whatever the number of streams.
+//
+// Only attempts in an active lifecycle phase are watched, and each attempt fires at most once.
+// $GRID_STALL_MS sets the timeout (default 5000, 0 disables).
+#pragma once
+
+struct StreamMetrics;
+
+// (Re)arms the stream after stream_metrics_watch_source() set its source; starts the wheel thread.
+void watchdog_watch(StreamMetrics* m);
+
+// Removes the stream from the wheel (StreamMetrics destructor).
+void watchdog_forget(StreamMetrics* m);
+
+// Timeout in ms from $GRID_STALL_MS; 0 when disabled.
+int watchdog_timeout_ms();